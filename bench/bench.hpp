@@ -0,0 +1,59 @@
+#pragma once
+
+#include "fs.hpp"
+
+#include <functional>
+#include <string>
+
+namespace cmkr {
+namespace bench {
+
+// Command line settings shared by all the suites
+struct Settings {
+    // Overrides the iteration count of every measurement (0 = suite default)
+    int iterations = 0;
+    // Preset for the synthetic monorepo: smoke, small, medium or large
+    std::string scale = "small";
+    // Override the shape of the synthetic monorepo preset (0 = preset value)
+    size_t subdirs = 0;
+    size_t targets = 0;
+    size_t sources = 0;
+    size_t conditions = 0;
+    size_t templates = 0;
+    // Write all the results to this file as JSON (empty = disabled)
+    std::string json;
+};
+
+const Settings &settings();
+
+// Runs the function the given number of times and returns the fastest run in milliseconds
+double measure(int iterations, const std::function<void()> &fn);
+
+// Prints a single result line
+void report(const std::string &suite, const std::string &name, double milliseconds);
+
+// Prints a result line with the throughput
+void report_rate(const std::string &suite, const std::string &name, double milliseconds, double bytes);
+
+// Prints a result line with a memory size
+void report_memory(const std::string &suite, const std::string &name, size_t bytes);
+
+// Peak resident set size of the process in bytes (0 if unknown)
+size_t peak_rss();
+
+// Returns an empty scratch directory for a suite
+fs::path scratch_directory(const std::string &suite);
+
+void write_file(const fs::path &path, const std::string &contents);
+
+void glob_suite();
+void emit_suite();
+void monorepo_suite();
+void parser_suite();
+void memory_suite();
+void files_suite();
+void library_suite();
+void watch_suite();
+
+} // namespace bench
+} // namespace cmkr
@@ -0,0 +1,128 @@
+#include "bench.hpp"
+#include "emitter.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace cmkr {
+namespace bench {
+
+// The emitter before the append-only buffer: a std::stringstream per argument
+struct LegacyCommand {
+    std::stringstream &ss;
+    int depth = 0;
+    std::string command;
+    bool first_arg = true;
+    bool had_newline = false;
+
+    LegacyCommand(std::stringstream &ss, int depth, std::string command) : ss(ss), depth(depth), command(std::move(command)) {
+    }
+
+    static std::string quote(const std::string &str) {
+        if (str.empty()) {
+            return "\"\"";
+        }
+        if (str.find_first_of("()#\"\\'> |/;") == std::string::npos)
+            return str;
+        std::string result;
+        result += "\"";
+        for (char ch : str) {
+            switch (ch) {
+            case '\\':
+            case '\"':
+                result += '\\';
+            default:
+                result += ch;
+                break;
+            }
+        }
+        result += "\"";
+        return result;
+    }
+
+    static std::string indent(int n) {
+        std::string result;
+        for (int i = 0; i < n; i++) {
+            result += '\t';
+        }
+        return result;
+    }
+
+    bool print_arg(const std::vector<std::string> &vec) {
+        had_newline = true;
+        for (const auto &value : vec) {
+            print_arg(value);
+        }
+        return true;
+    }
+
+    template <class T>
+    bool print_arg(const T &value) {
+        std::stringstream tmp;
+        tmp << value;
+        auto str = tmp.str();
+        if (str.empty()) {
+            return true;
+        }
+
+        if (had_newline) {
+            first_arg = false;
+            ss << '\n' << indent(depth + 1);
+        } else if (first_arg) {
+            first_arg = false;
+        } else {
+            ss << ' ';
+        }
+
+        ss << quote(str);
+        return true;
+    }
+
+    template <class... Ts>
+    void operator()(Ts &&...values) {
+        ss << indent(depth) << command << '(';
+        (void)std::initializer_list<bool>{print_arg(values)...};
+        if (had_newline)
+            ss << '\n' << indent(depth);
+        ss << ")\n";
+    }
+};
+
+void emit_suite() {
+    // A single target with 50k sources, spread over nested directories
+    std::vector<std::string> sources;
+    for (int i = 0; i < 50000; i++) {
+        sources.push_back("src/module" + std::to_string(i / 1000) + "/component" + std::to_string(i / 100 % 10) + "/file" + std::to_string(i) +
+                          ".cpp");
+    }
+    std::vector<std::string> definitions = {"MYTARGET_EXPORTS", "MYTARGET_VERSION=\"1.0\""};
+    const int iterations = 10;
+
+    std::string expected;
+    auto legacy = [&]() {
+        std::stringstream ss;
+        LegacyCommand(ss, 1, "set")("mytarget_SOURCES", sources);
+        LegacyCommand(ss, 1, "target_sources")("mytarget", "PRIVATE", "${mytarget_SOURCES}");
+        LegacyCommand(ss, 1, "target_compile_definitions")("mytarget", "PRIVATE", definitions);
+        expected = ss.str();
+    };
+    legacy();
+    report_rate("emit", "stringstream per argument", measure(iterations, legacy), static_cast<double>(expected.size()));
+
+    gen::Buffer buffer;
+    auto current = [&]() {
+        buffer.clear();
+        gen::Command(buffer, 1, "set", "")("mytarget_SOURCES", sources);
+        gen::Command(buffer, 1, "target_sources", "")("mytarget", "PRIVATE", "${mytarget_SOURCES}");
+        gen::Command(buffer, 1, "target_compile_definitions", "")("mytarget", "PRIVATE", definitions);
+    };
+    current();
+    if (buffer.str() != expected) {
+        throw std::runtime_error("emit: buffer output differs from the stringstream emitter");
+    }
+    report_rate("emit", "append-only buffer", measure(iterations, current), static_cast<double>(buffer.size()));
+}
+
+} // namespace bench
+} // namespace cmkr
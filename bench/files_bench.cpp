@@ -0,0 +1,128 @@
+#include "bench.hpp"
+#include "files.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace bench {
+
+// The comparison before the files layer: read everything through istreambuf_iterator
+static bool legacy_update(const fs::path &path, const std::string &contents) {
+    if (fs::exists(path)) {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open()) {
+            throw std::runtime_error("Failed to read " + path.string());
+        }
+        std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        if (data == contents) {
+            return false;
+        }
+    }
+    // Truncates the file in place
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error("Failed to create " + path.string());
+    }
+    ofs << contents;
+    return true;
+}
+
+static size_t generated_files() {
+    const auto &scale = settings().scale;
+    if (scale == "smoke") {
+        return 100;
+    } else if (scale == "small") {
+        return 1000;
+    } else if (scale == "medium") {
+        return 4000;
+    } else if (scale == "large") {
+        return 20000;
+    }
+    throw std::runtime_error("Unknown scale '" + scale + "' (expected smoke, small, medium or large)");
+}
+
+// Something the size of a generated CMakeLists.txt (4-12 KB)
+static std::string generated_contents(size_t index) {
+    std::string contents = "# This file is automatically generated from cmake.toml - DO NOT EDIT\n";
+    auto sources = 64 + (index % 3) * 64;
+    for (size_t i = 0; i < sources; i++) {
+        contents += "\t\"src/target" + std::to_string(index) + "/source" + std::to_string(i) + ".cpp\"\n";
+    }
+    return contents;
+}
+
+void files_suite() {
+    auto root = scratch_directory("files");
+    auto count = generated_files();
+    std::vector<fs::path> paths;
+    std::vector<std::string> contents;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        paths.push_back(root / ("d" + std::to_string(i / 100)) / ("CMakeLists" + std::to_string(i) + ".txt"));
+        contents.push_back(generated_contents(i));
+        bytes += contents.back().size();
+        write_file(paths.back(), contents.back());
+    }
+    printf("files    %zu generated files, %.1f MB\n", count, static_cast<double>(bytes) / (1024.0 * 1024.0));
+
+    // Same size, only the last byte differs: the worst case for the comparison
+    std::vector<std::string> changed = contents;
+    for (auto &data : changed) {
+        data.back() = '#';
+    }
+
+    const int iterations = 5;
+    auto run = [&](bool (*update)(const fs::path &, const std::string &), const std::vector<std::string> &data) {
+        size_t written = 0;
+        for (size_t i = 0; i < count; i++) {
+            written += update(paths[i], data[i]) ? 1 : 0;
+        }
+        return written;
+    };
+    auto check = [](size_t written, size_t expected) {
+        if (written != expected) {
+            throw std::runtime_error("Unexpected number of written files");
+        }
+    };
+
+    report_rate("files", "legacy unchanged", measure(iterations, [&]() { check(run(legacy_update, contents), 0); }), static_cast<double>(bytes));
+    report_rate("files", "size-first unchanged", measure(iterations, [&]() { check(run(files::update, contents), 0); }),
+                static_cast<double>(bytes));
+
+    // Alternate between the two versions so every run rewrites every file
+    bool flip = false;
+    report_rate("files", "legacy changed", measure(iterations, [&]() {
+                    flip = !flip;
+                    check(run(legacy_update, flip ? changed : contents), count);
+                }),
+                static_cast<double>(bytes));
+    report_rate("files", "atomic changed", measure(iterations, [&]() {
+                    flip = !flip;
+                    check(run(files::update, flip ? changed : contents), count);
+                }),
+                static_cast<double>(bytes));
+
+    // A different size is detected without reading the file
+    std::vector<std::string> resized = contents;
+    for (auto &data : resized) {
+        data += '\n';
+    }
+    report_rate("files", "legacy resized", measure(iterations, [&]() {
+                    flip = !flip;
+                    check(run(legacy_update, flip ? resized : contents), count);
+                }),
+                static_cast<double>(bytes));
+    report_rate("files", "atomic resized", measure(iterations, [&]() {
+                    flip = !flip;
+                    check(run(files::update, flip ? resized : contents), count);
+                }),
+                static_cast<double>(bytes));
+}
+
+} // namespace bench
+} // namespace cmkr
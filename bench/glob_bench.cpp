@@ -0,0 +1,151 @@
+#include "bench.hpp"
+#include "directory_cache.hpp"
+#include "glob.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace cmkr {
+namespace bench {
+
+// The expansion before the glob engine: a separate directory walk for every pattern
+static std::vector<std::string> legacy_expand(const std::vector<std::string> &patterns, const fs::path &toml_dir) {
+    std::vector<std::string> paths;
+    for (const auto &pattern : patterns) {
+        fs::path source_path(pattern);
+        std::string stem, extension;
+        auto filename = source_path.filename().string();
+        auto dot_position = filename.find('.');
+        if (dot_position != std::string::npos) {
+            stem = filename.substr(0, dot_position);
+            extension = filename.substr(dot_position);
+        } else {
+            stem = filename;
+        }
+
+        auto has_extension = [](const fs::path &file_path, const std::string &extension) {
+            auto path = file_path.string();
+            return path.rfind(extension) == path.length() - extension.length();
+        };
+
+        if (stem == "*") {
+            for (const auto &f : fs::directory_iterator(toml_dir / source_path.parent_path(), fs::directory_options::follow_directory_symlink)) {
+                if (!f.is_directory() && has_extension(f.path(), extension)) {
+                    paths.push_back(fs::relative(f, toml_dir).generic_string());
+                }
+            }
+        } else if (stem == "**") {
+            for (const auto &f :
+                 fs::recursive_directory_iterator(toml_dir / source_path.parent_path(), fs::directory_options::follow_directory_symlink)) {
+                if (!f.is_directory() && has_extension(f.path(), extension)) {
+                    paths.push_back(fs::relative(f, toml_dir).generic_string());
+                }
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static std::vector<std::string> matcher_expand(const std::vector<std::string> &patterns, const fs::path &toml_dir, pool::ThreadPool &pool) {
+    glob::Matcher matcher;
+    for (const auto &pattern : patterns) {
+        matcher.add(pattern);
+    }
+
+    // A fresh cache for every run, the directory listings are not shared between runs
+    dircache::DirectoryCache directories;
+    auto result = matcher.expand(directories, pool, toml_dir);
+
+    std::vector<std::string> paths;
+    for (const auto &matches : result.matches) {
+        for (const auto &match : matches) {
+            paths.push_back(match.generic_string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Symbolic links to a directory on the current path are not followed, other links are
+static void check_symlink_cycles(pool::ThreadPool &pool) {
+    auto root = scratch_directory("glob-cycle");
+    write_file(root / "cycle" / "root.cpp", "");
+    write_file(root / "cycle" / "a" / "file.cpp", "");
+    std::error_code ec;
+    fs::create_directory_symlink("..", root / "cycle" / "a" / "loop", ec);
+    if (!ec) {
+        fs::create_directory_symlink(".", root / "cycle" / "a" / "self", ec);
+    }
+    if (!ec) {
+        fs::create_directory_symlink("a", root / "cycle" / "b", ec);
+    }
+    if (ec) {
+        // Creating symbolic links requires extra privileges on Windows
+        printf("glob     symbolic link cycles skipped (%s)\n", ec.message().c_str());
+        return;
+    }
+
+    // Like the legacy walk (fs::relative), the matches through b are resolved to a
+    const std::vector<std::string> expected = {"cycle/a/file.cpp", "cycle/a/file.cpp", "cycle/root.cpp"};
+    if (matcher_expand({"cycle/**.cpp"}, root, pool) != expected) {
+        throw std::runtime_error("glob: symbolic link cycles are not detected (" + std::to_string(pool.jobs()) + " jobs)");
+    }
+}
+
+void glob_suite() {
+    // 16 modules with 8 components of 24 files each
+    auto root = scratch_directory("glob");
+    const char *extensions[] = {".cpp", ".hpp", ".c", ".h", ".txt", ".inl"};
+    for (int module = 0; module < 16; module++) {
+        for (int component = 0; component < 8; component++) {
+            auto directory = root / "src" / ("module" + std::to_string(module)) / ("component" + std::to_string(component));
+            for (int file = 0; file < 24; file++) {
+                write_file(directory / ("file" + std::to_string(file) + extensions[file % 6]), "");
+            }
+        }
+        write_file(root / "src" / ("module" + std::to_string(module) + ".cpp"), "");
+    }
+
+    // A typical target that lists every extension separately
+    std::vector<std::string> patterns = {
+        "src/**.cpp", "src/**.hpp", "src/**.c", "src/**.h", "src/**.inl", "src/*.cpp",
+    };
+    const int iterations = 5;
+
+    auto expected = legacy_expand(patterns, root);
+    report("glob", "legacy per-pattern walk", measure(iterations, [&]() {
+               legacy_expand(patterns, root);
+           }));
+
+    pool::ThreadPool serial(1);
+    pool::ThreadPool parallel(0);
+    check_symlink_cycles(serial);
+    check_symlink_cycles(parallel);
+    if (matcher_expand(patterns, root, serial) != expected) {
+        throw std::runtime_error("glob: matcher results differ from the legacy walk");
+    }
+    report("glob", "matcher single pass (1 job)", measure(iterations, [&]() {
+               matcher_expand(patterns, root, serial);
+           }));
+
+    report("glob", "matcher single pass (" + std::to_string(parallel.jobs()) + " jobs)", measure(iterations, [&]() {
+               matcher_expand(patterns, root, parallel);
+           }));
+
+    // The same sources with a single pattern, which does not match src/*.cpp twice
+    std::vector<std::string> braces = {"src/**/*.{cpp,hpp,c,h,inl}"};
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+    if (matcher_expand(braces, root, serial) != expected) {
+        throw std::runtime_error("glob: brace pattern results differ from the legacy walk");
+    }
+    report("glob", "matcher braces (1 job)", measure(iterations, [&]() {
+               matcher_expand(braces, root, serial);
+           }));
+}
+
+} // namespace bench
+} // namespace cmkr
@@ -0,0 +1,65 @@
+#include "bench.hpp"
+#include "library.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace bench {
+
+static void check(bool condition, const std::string &message) {
+    if (!condition) {
+        throw std::runtime_error("library: " + message);
+    }
+}
+
+static std::string project_toml(const std::string &name) {
+    return "[project]\nname = \"" + name + "\"\n\n[target." + name + "]\ntype = \"executable\"\nsources = [\"src/main.cpp\"]\n";
+}
+
+static size_t generated_projects() {
+    const auto &scale = settings().scale;
+    if (scale == "smoke") {
+        return 20;
+    } else if (scale == "small") {
+        return 200;
+    } else if (scale == "medium") {
+        return 1000;
+    } else if (scale == "large") {
+        return 5000;
+    }
+    throw std::runtime_error("Unknown scale '" + scale + "' (expected smoke, small, medium or large)");
+}
+
+void library_suite() {
+    auto root = scratch_directory("library");
+
+    auto count = generated_projects();
+    std::vector<fs::path> directories;
+    for (size_t i = 0; i < count; i++) {
+        auto name = "project" + std::to_string(i);
+        directories.push_back(root / name);
+        write_file(directories.back() / "src/main.cpp", "int main() {}\n");
+        write_file(directories.back() / "cmake.toml", project_toml(name));
+    }
+    printf("library  %zu projects\n", count);
+
+    const int iterations = 5;
+    report("library", "in memory", measure(iterations, [&]() {
+               for (size_t i = 0; i < count; i++) {
+                   check(lib::generate_toml(directories[i].string(), project_toml("project" + std::to_string(i))).success, "generation failed");
+               }
+           }));
+    lib::Options options;
+    options.write = true;
+    report("library", "written", measure(iterations, [&]() {
+               for (const auto &directory : directories) {
+                   check(lib::generate(directory.string(), options).success, "generation failed");
+               }
+           }));
+}
+
+} // namespace bench
+} // namespace cmkr
@@ -0,0 +1,247 @@
+#include "bench.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace cmkr {
+namespace bench {
+
+static Settings g_settings;
+
+struct Result {
+    std::string suite;
+    std::string name;
+    double milliseconds = 0;
+    // Zero if the result has no throughput
+    double bytes_per_second = 0;
+    // Only set for memory results
+    size_t bytes = 0;
+};
+
+static std::vector<Result> g_results;
+
+const Settings &settings() {
+    return g_settings;
+}
+
+double measure(int iterations, const std::function<void()> &fn) {
+    if (g_settings.iterations > 0) {
+        iterations = g_settings.iterations;
+    }
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+void report(const std::string &suite, const std::string &name, double milliseconds) {
+    printf("%-8s %-32s %10.3f ms\n", suite.c_str(), name.c_str(), milliseconds);
+    Result result;
+    result.suite = suite;
+    result.name = name;
+    result.milliseconds = milliseconds;
+    g_results.push_back(result);
+}
+
+void report_rate(const std::string &suite, const std::string &name, double milliseconds, double bytes) {
+    auto rate = milliseconds > 0 ? bytes / (milliseconds / 1000.0) : 0.0;
+    printf("%-8s %-32s %10.3f ms %10.1f MB/s\n", suite.c_str(), name.c_str(), milliseconds, rate / (1024.0 * 1024.0));
+    Result result;
+    result.suite = suite;
+    result.name = name;
+    result.milliseconds = milliseconds;
+    result.bytes_per_second = rate;
+    g_results.push_back(result);
+}
+
+void report_memory(const std::string &suite, const std::string &name, size_t bytes) {
+    printf("%-8s %-32s %10.1f MB\n", suite.c_str(), name.c_str(), static_cast<double>(bytes) / (1024.0 * 1024.0));
+    Result result;
+    result.suite = suite;
+    result.name = name;
+    result.bytes = bytes;
+    g_results.push_back(result);
+}
+
+size_t peak_rss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+fs::path scratch_directory(const std::string &suite) {
+    auto directory = fs::temp_directory_path() / "cmkr-bench" / suite;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    return directory;
+}
+
+void write_file(const fs::path &path, const std::string &contents) {
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error("Failed to create " + path.string());
+    }
+    ofs << contents;
+}
+
+static std::string json_string(const std::string &str) {
+    std::string result = "\"";
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            result += '\\';
+        }
+        result += ch;
+    }
+    result += '"';
+    return result;
+}
+
+static void write_results(const std::string &file) {
+    std::ostringstream oss;
+    oss << "{\n  \"results\": [";
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const auto &result = g_results[i];
+        oss << (i == 0 ? "\n" : ",\n");
+        oss << "    {\"suite\": " << json_string(result.suite) << ", \"name\": " << json_string(result.name);
+        if (result.bytes > 0) {
+            oss << ", \"bytes\": " << result.bytes;
+        } else {
+            oss << ", \"milliseconds\": " << result.milliseconds;
+        }
+        if (result.bytes_per_second > 0) {
+            oss << ", \"bytes_per_second\": " << result.bytes_per_second;
+        }
+        oss << '}';
+    }
+    oss << "\n  ]\n}\n";
+    write_file(fs::absolute(file), oss.str());
+}
+
+// Parses --name=value arguments into the settings, returns false for suite names
+static bool parse_setting(const std::string &arg) {
+    if (arg.compare(0, 2, "--") != 0) {
+        return false;
+    }
+    auto equals = arg.find('=');
+    if (equals == std::string::npos) {
+        throw std::runtime_error("Missing value for " + arg);
+    }
+    auto name = arg.substr(2, equals - 2);
+    auto value = arg.substr(equals + 1);
+
+    auto number = [&]() {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+            throw std::runtime_error("Invalid value for --" + name + ": '" + value + "'");
+        }
+        return static_cast<size_t>(std::stoull(value));
+    };
+
+    if (name == "iterations") {
+        g_settings.iterations = static_cast<int>(number());
+    } else if (name == "scale") {
+        g_settings.scale = value;
+    } else if (name == "subdirs") {
+        g_settings.subdirs = number();
+    } else if (name == "targets") {
+        g_settings.targets = number();
+    } else if (name == "sources") {
+        g_settings.sources = number();
+    } else if (name == "conditions") {
+        g_settings.conditions = number();
+    } else if (name == "templates") {
+        g_settings.templates = number();
+    } else if (name == "json") {
+        g_settings.json = value;
+    } else {
+        throw std::runtime_error("Unknown argument '" + arg + "'");
+    }
+    return true;
+}
+
+} // namespace bench
+} // namespace cmkr
+
+int main(int argc, char **argv) try {
+    struct Suite {
+        const char *name;
+        void (*run)();
+    };
+    const Suite suites[] = {
+        {"glob", cmkr::bench::glob_suite},
+        {"emit", cmkr::bench::emit_suite},
+        {"monorepo", cmkr::bench::monorepo_suite},
+        {"parser", cmkr::bench::parser_suite},
+        {"memory", cmkr::bench::memory_suite},
+        {"files", cmkr::bench::files_suite},
+        {"library", cmkr::bench::library_suite},
+        {"watch", cmkr::bench::watch_suite},
+    };
+
+    std::vector<std::string> selected;
+    for (int i = 1; i < argc; i++) {
+        if (!cmkr::bench::parse_setting(argv[i])) {
+            selected.push_back(argv[i]);
+        }
+    }
+    for (const auto &name : selected) {
+        auto found = false;
+        for (const auto &suite : suites) {
+            found = found || name == suite.name;
+        }
+        if (!found) {
+            throw std::runtime_error("Unknown suite '" + name + "'");
+        }
+    }
+
+    for (const auto &suite : suites) {
+        auto enabled = selected.empty();
+        for (const auto &name : selected) {
+            enabled = enabled || name == suite.name;
+        }
+        if (enabled) {
+            suite.run();
+        }
+    }
+
+    const auto &json = cmkr::bench::settings().json;
+    if (!json.empty()) {
+        cmkr::bench::write_results(json);
+    }
+    return EXIT_SUCCESS;
+} catch (const std::exception &e) {
+    (void)fprintf(stderr, "[cmkr_bench] error: %s\n", e.what());
+    return EXIT_FAILURE;
+}
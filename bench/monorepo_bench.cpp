@@ -0,0 +1,163 @@
+#include "bench.hpp"
+#include "cmake_generator.hpp"
+#include "trace.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace bench {
+
+// Shape of the synthetic monorepo. The subdirectories are grouped in directories of
+// 25, every target has its own source directory and links to the previous target.
+struct Shape {
+    size_t subdirs = 0;
+    size_t targets = 0;
+    size_t sources = 0;
+    size_t conditions = 0;
+    size_t templates = 0;
+};
+
+static Shape monorepo_shape() {
+    const auto &s = settings();
+    Shape shape;
+    if (s.scale == "smoke") {
+        shape = Shape{4, 2, 3, 1, 1};
+    } else if (s.scale == "small") {
+        shape = Shape{50, 4, 10, 2, 2};
+    } else if (s.scale == "medium") {
+        shape = Shape{250, 10, 10, 2, 2};
+    } else if (s.scale == "large") {
+        // 100k sources in 5k targets
+        shape = Shape{500, 10, 20, 4, 4};
+    } else {
+        throw std::runtime_error("Unknown scale '" + s.scale + "' (expected smoke, small, medium or large)");
+    }
+    auto override = [](size_t &value, size_t setting) {
+        if (setting > 0) {
+            value = setting;
+        }
+    };
+    override(shape.subdirs, s.subdirs);
+    override(shape.targets, s.targets);
+    override(shape.sources, s.sources);
+    override(shape.conditions, s.conditions);
+    override(shape.templates, s.templates);
+    return shape;
+}
+
+static std::string numbered(const char *prefix, size_t index) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s%04zu", prefix, index);
+    return name;
+}
+
+static void write_monorepo(const fs::path &root, const Shape &shape) {
+    const size_t group_size = 25;
+    auto groups = (shape.subdirs + group_size - 1) / group_size;
+
+    // The cmkr.cmake bootstrap would be written to the working directory
+    std::string toml = "[cmake]\nversion = \"3.15\"\ncmkr-include = false\n\n[project]\nname = \"monorepo\"\n\n";
+    if (shape.conditions > 0) {
+        toml += "[conditions]\n";
+        for (size_t c = 0; c < shape.conditions; c++) {
+            toml += "c" + std::to_string(c) + " = \"MONOREPO_C" + std::to_string(c) + "\"\n";
+        }
+        toml += "\n";
+    }
+    for (size_t t = 0; t < shape.templates; t++) {
+        toml += "[template.tpl" + std::to_string(t) + "]\n";
+        toml += "type = \"static\"\n";
+        toml += "compile-features = [\"cxx_std_11\"]\n";
+        toml += "compile-definitions = [\"MONOREPO_TEMPLATE" + std::to_string(t) + "\"]\n\n";
+    }
+    for (size_t g = 0; g < groups; g++) {
+        toml += "[subdir." + numbered("g", g) + "]\n";
+    }
+    write_file(root / "cmake.toml", toml);
+
+    for (size_t g = 0; g < groups; g++) {
+        auto group = numbered("g", g);
+        std::string group_toml;
+        for (size_t d = g * group_size; d < shape.subdirs && d < (g + 1) * group_size; d++) {
+            group_toml += "[subdir." + numbered("d", d) + "]\n";
+        }
+        write_file(root / group / "cmake.toml", group_toml);
+
+        for (size_t d = g * group_size; d < shape.subdirs && d < (g + 1) * group_size; d++) {
+            auto subdir = numbered("d", d);
+            auto directory = root / group / subdir;
+            std::string subdir_toml;
+            for (size_t t = 0; t < shape.targets; t++) {
+                auto target = "t" + std::to_string(t);
+                auto name = subdir + "_" + target;
+                subdir_toml += "[target." + name + "]\n";
+                if (shape.templates > 0) {
+                    subdir_toml += "type = \"tpl" + std::to_string((d + t) % shape.templates) + "\"\n";
+                } else {
+                    subdir_toml += "type = \"static\"\n";
+                }
+                subdir_toml += "sources = [\"" + target + "/*.cpp\", \"" + target + "/*.hpp\"]\n";
+                subdir_toml += "include-directories = [\"" + target + "\"]\n";
+                for (size_t c = 0; c < shape.conditions; c++) {
+                    auto condition = "c" + std::to_string(c);
+                    subdir_toml += condition + ".sources = [\"" + target + "/" + condition + "/*.cpp\"]\n";
+                    subdir_toml += condition + ".compile-definitions = [\"" + name + "_" + condition + "\"]\n";
+                    write_file(directory / target / condition / (condition + ".cpp"), "// " + name + "\n");
+                }
+                if (t > 0) {
+                    subdir_toml += "link-libraries = [\"" + subdir + "_t" + std::to_string(t - 1) + "\"]\n";
+                }
+                subdir_toml += "\n";
+
+                write_file(directory / target / (target + ".hpp"), "#pragma once\n");
+                for (size_t s = 0; s < shape.sources; s++) {
+                    write_file(directory / target / (numbered("source", s) + ".cpp"), "#include \"" + target + ".hpp\"\n");
+                }
+            }
+            write_file(directory / "cmake.toml", subdir_toml);
+        }
+    }
+}
+
+static void measure_generation(const char *name, const fs::path &root, gen::Options options) {
+    std::vector<trace::Recorder::Total> best_totals;
+    long long best = -1;
+    measure(5, [&]() {
+        trace::Recorder recorder;
+        options.recorder = &recorder;
+        gen::generate_cmake(root.string().c_str(), options);
+        auto elapsed = recorder.now();
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+            best_totals = recorder.totals();
+        }
+    });
+
+    report("monorepo", name, static_cast<double>(best) / 1000.0);
+    // Summed over all the threads, so the phases can add up to more than the wall time
+    for (const auto &total : best_totals) {
+        report("monorepo", std::string(name) + " " + total.category, static_cast<double>(total.duration) / 1000.0);
+    }
+}
+
+void monorepo_suite() {
+    auto shape = monorepo_shape();
+    auto root = scratch_directory("monorepo");
+    write_monorepo(root, shape);
+    printf("monorepo %zu subdirs, %zu targets, %zu sources, %zu conditions, %zu templates\n", shape.subdirs, shape.subdirs * shape.targets,
+           shape.subdirs * shape.targets * (shape.sources + 1 + shape.conditions), shape.conditions, shape.templates);
+
+    gen::Options options;
+    measure_generation("full", root, options);
+
+    // Fill the cache first, so every directory is up to date when measuring
+    options.cache_dir = (root / "cmkr-cache").string();
+    gen::generate_cmake(root.string().c_str(), options);
+    measure_generation("incremental", root, options);
+}
+
+} // namespace bench
+} // namespace cmkr
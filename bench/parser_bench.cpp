@@ -0,0 +1,80 @@
+#include "bench.hpp"
+#include "project_parser.hpp"
+
+#include <string>
+
+namespace cmkr {
+namespace bench {
+
+// A single cmake.toml with thousands of targets that use most of the target keys, each
+// target has conditional definitions for the given number of extra conditions
+static std::string large_toml(size_t targets, size_t conditions) {
+    std::string toml = "[project]\nname = \"parser\"\n\n[conditions]\nfeature = \"PARSER_FEATURE\"\n";
+    for (size_t c = 0; c < conditions; c++) {
+        toml += "c" + std::to_string(c) + " = \"PARSER_C" + std::to_string(c) + "\"\n";
+    }
+    toml += "\n";
+    for (size_t i = 0; i < targets; i++) {
+        auto name = "target" + std::to_string(i);
+        toml += "[target." + name + "]\n";
+        toml += "type = \"static\"\n";
+        toml += "sources = [\"" + name + "/*.cpp\"]\n";
+        toml += "windows.sources = [\"" + name + "/windows/*.cpp\"]\n";
+        toml += "linux.sources = [\"" + name + "/linux/*.cpp\"]\n";
+        toml += "headers = [\"" + name + "/*.hpp\"]\n";
+        toml += "include-directories = [\"" + name + "/include\"]\n";
+        toml += "private-include-directories = [\"" + name + "/src\"]\n";
+        toml += "compile-definitions = [\"" + name + "_EXPORTS\"]\n";
+        toml += "feature.compile-definitions = [\"" + name + "_FEATURE\"]\n";
+        toml += "private-compile-definitions = [\"" + name + "_PRIVATE\"]\n";
+        toml += "compile-features = [\"cxx_std_11\"]\n";
+        toml += "compile-options = [\"-Wall\"]\n";
+        toml += "msvc.compile-options = [\"/W4\"]\n";
+        toml += "link-libraries = [\"Threads::Threads\"]\n";
+        toml += "private-link-libraries = [\"dl\"]\n";
+        toml += "link-options = [\"-g\"]\n";
+        toml += "precompile-headers = [\"<vector>\"]\n";
+        toml += "cmake-before = \"message(STATUS before)\"\n";
+        toml += "cmake-after = \"message(STATUS after)\"\n";
+        toml += "properties.OUTPUT_NAME = \"" + name + "_output\"\n";
+        for (size_t c = 0; c < conditions; c++) {
+            toml += "c" + std::to_string(c) + ".compile-definitions = [\"" + name + "_C" + std::to_string(c) + "\"]\n";
+        }
+        toml += "\n";
+    }
+    return toml;
+}
+
+static void measure_project(const std::string &name, size_t targets, size_t conditions) {
+    auto directory = scratch_directory("parser") / name;
+    write_file(directory / "cmake.toml", large_toml(targets, conditions));
+
+    // The document is parsed by the first iteration, the rest only measure the key
+    // lookups and validation of the parsed TOML
+    auto path = directory.string();
+    auto milliseconds = measure(5, [&path]() {
+        parser::Project project(nullptr, path, false);
+    });
+    report("parser", std::to_string(targets) + " targets, " + std::to_string(conditions) + " conditions", milliseconds);
+}
+
+void memory_suite() {
+    // Run on its own, the peak resident set size covers the whole process
+    const size_t targets = 10000;
+    auto directory = scratch_directory("memory");
+    write_file(directory / "cmake.toml", large_toml(targets, 0));
+
+    auto before = peak_rss();
+    parser::Project project(nullptr, directory.string(), false);
+    report_memory("memory", std::to_string(targets) + " targets, peak RSS", peak_rss());
+    report_memory("memory", std::to_string(targets) + " targets, parse growth", peak_rss() - before);
+}
+
+void parser_suite() {
+    measure_project("many", 5000, 0);
+    // Wide tables with a condition sub-table per condition
+    measure_project("wide", 500, 64);
+}
+
+} // namespace bench
+} // namespace cmkr
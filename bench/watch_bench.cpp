@@ -0,0 +1,172 @@
+#include "bench.hpp"
+#include "cmake_generator.hpp"
+#include "project_parser.hpp"
+#include "watch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace cmkr {
+namespace bench {
+
+#ifdef __linux__
+
+static size_t watched_subdirs() {
+    const auto &scale = settings().scale;
+    if (scale == "smoke") {
+        return 10;
+    } else if (scale == "small") {
+        return 100;
+    } else if (scale == "medium") {
+        return 500;
+    } else if (scale == "large") {
+        return 2000;
+    }
+    throw std::runtime_error("Unknown scale '" + scale + "' (expected smoke, small, medium or large)");
+}
+
+static std::string subdir_name(size_t index) {
+    return "lib" + std::to_string(index);
+}
+
+static std::string subdir_toml(size_t index, const std::string &extra = std::string()) {
+    return "[target." + subdir_name(index) + "]\ntype = \"component\"\nsources = [\"src/*.cpp\"]\n" + extra;
+}
+
+// Collects the generations reported by the watch thread
+class Generations {
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<watch::Generation> m_queue;
+
+  public:
+    void push(const watch::Generation &generation) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(generation);
+        m_cv.notify_all();
+    }
+
+    watch::Generation pop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_cv.wait_for(lock, std::chrono::seconds(10), [this]() { return !m_queue.empty(); })) {
+            throw std::runtime_error("watch: no generation within 10 seconds");
+        }
+        auto generation = m_queue.front();
+        m_queue.pop_front();
+        return generation;
+    }
+};
+
+// Returns the time the watch spent generating
+static double check_written(const watch::Generation &generation, const fs::path &expected, const std::string &change) {
+    if (!generation.success) {
+        throw std::runtime_error("watch: generation failed after " + change + ": " + generation.error);
+    }
+    if (generation.written.size() != 1 || fs::path(generation.written[0]) != expected) {
+        std::string written;
+        for (const auto &file : generation.written) {
+            written += " " + file;
+        }
+        throw std::runtime_error("watch: " + change + " should only regenerate " + expected.string() + ", written:" + written);
+    }
+    return generation.milliseconds;
+}
+
+void watch_suite() {
+    auto root = scratch_directory("watch");
+    auto subdirs = watched_subdirs();
+    // Like the monorepo suite, the targets use a template of the root project
+    std::string toml = "[cmake]\nversion = \"3.15\"\ncmkr-include = false\n\n[project]\nname = \"watch\"\n\n";
+    toml += "[template.component]\ntype = \"static\"\n\n";
+    for (size_t i = 0; i < subdirs; i++) {
+        toml += "[subdir." + subdir_name(i) + "]\n";
+        write_file(root / subdir_name(i) / "cmake.toml", subdir_toml(i));
+        write_file(root / subdir_name(i) / "src" / "a.cpp", "void a() {}\n");
+    }
+    write_file(root / "cmake.toml", toml);
+    printf("watch    %zu subdirectories\n", subdirs);
+
+    Generations generations;
+    std::atomic<bool> stop(false);
+    std::exception_ptr error;
+    watch::Options options;
+    options.stop = &stop;
+    options.report = [&generations](const watch::Generation &generation) {
+        generations.push(generation);
+    };
+    std::thread thread([&]() {
+        try {
+            watch::run(root.string(), options);
+        } catch (...) {
+            error = std::current_exception();
+            watch::Generation failed;
+            failed.error = "watch::run threw";
+            generations.push(failed);
+        }
+    });
+
+    try {
+        auto initial = generations.pop();
+        if (!initial.success || !initial.initial || initial.written.size() != subdirs + 1) {
+            throw std::runtime_error("watch: the initial generation failed: " + initial.error);
+        }
+        report("watch", "initial generation", initial.milliseconds);
+
+        // The latency includes the 20 ms the watch waits for the changes to settle
+        size_t change = 0;
+        double regeneration = -1;
+        auto regenerated = [&regeneration](double milliseconds) {
+            if (regeneration < 0 || milliseconds < regeneration) {
+                regeneration = milliseconds;
+            }
+        };
+        auto target = subdirs / 2;
+        auto cmakelists = root / subdir_name(target) / "CMakeLists.txt";
+        report("watch", "new source", measure(5, [&]() {
+                   write_file(root / subdir_name(target) / "src" / ("new" + std::to_string(change++) + ".cpp"), "void b() {}\n");
+                   regenerated(check_written(generations.pop(), cmakelists, "adding a source"));
+               }));
+        report("watch", "cmake.toml edit", measure(5, [&]() {
+                   auto definition = "compile-definitions = [\"CHANGE" + std::to_string(change++) + "\"]\n";
+                   write_file(root / subdir_name(target) / "cmake.toml", subdir_toml(target, definition));
+                   regenerated(check_written(generations.pop(), cmakelists, "editing a cmake.toml"));
+               }));
+        report("watch", "regeneration", regeneration);
+    } catch (...) {
+        stop = true;
+        thread.join();
+        throw;
+    }
+    stop = true;
+    thread.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // What every edit cost before: a full generation in a new process
+    report("watch", "full generation", measure(3, [&]() {
+               parser::clear_documents();
+               gen::Options generator;
+               gen::generate_cmake(root.string().c_str(), generator);
+           }));
+    parser::clear_documents();
+}
+
+#else
+
+void watch_suite() {
+    printf("watch    skipped (only supported on Linux)\n");
+}
+
+#endif
+
+} // namespace bench
+} // namespace cmkr
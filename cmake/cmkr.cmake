@@ -18,6 +18,15 @@ set(CMKR_SKIP_GENERATION OFF CACHE BOOL "skip automatic cmkr generation")
 set(CMKR_BUILD_TYPE "Debug" CACHE STRING "cmkr build configuration")
 mark_as_advanced(CMKR_REPO CMKR_TAG CMKR_COMMIT_HASH CMKR_EXECUTABLE CMKR_SKIP_GENERATION CMKR_BUILD_TYPE)
 
+# Offline bootstrapping (the SHA256 can also be stored next to the file as <file>.sha256)
+# - CMKR_PREBUILT_DIR contains <tag>/<host>/cmkr or a cmkr-<tag>-<host>.tar.gz/.zip archive
+# - CMKR_SOURCE_ARCHIVE is a source tarball of cmkr, used instead of git clone
+set(CMKR_PREBUILT_DIR "$ENV{CMKR_PREBUILT_DIR}" CACHE PATH "Directory with prebuilt cmkr binaries")
+set(CMKR_PREBUILT_SHA256 "" CACHE STRING "SHA256 of the prebuilt cmkr binary or archive")
+set(CMKR_SOURCE_ARCHIVE "$ENV{CMKR_SOURCE_ARCHIVE}" CACHE FILEPATH "cmkr source archive")
+set(CMKR_SOURCE_ARCHIVE_SHA256 "" CACHE STRING "SHA256 of the cmkr source archive")
+mark_as_advanced(CMKR_PREBUILT_DIR CMKR_PREBUILT_SHA256 CMKR_SOURCE_ARCHIVE CMKR_SOURCE_ARCHIVE_SHA256)
+
 # Disable cmkr if generation is disabled
 if(DEFINED ENV{CI} OR CMKR_SKIP_GENERATION OR CMKR_BUILD_SKIP_GENERATION)
     message(STATUS "[cmkr] Skipping automatic cmkr generation")
@@ -79,6 +88,88 @@ endif()
 set(CMKR_DIRECTORY "${CMKR_DIRECTORY_PREFIX}${CMKR_TAG}")
 set(CMKR_CACHED_EXECUTABLE "${CMKR_DIRECTORY}/bin/${CMKR_EXECUTABLE_NAME}")
 
+# Prebuilt binaries are keyed by the host, for example x86_64-linux or amd64-windows
+cmake_host_system_information(RESULT CMKR_HOST_PLATFORM QUERY OS_PLATFORM)
+string(TOLOWER "${CMKR_HOST_PLATFORM}-${CMAKE_HOST_SYSTEM_NAME}" CMKR_HOST)
+unset(CMKR_HOST_PLATFORM)
+
+# Checks the SHA256 of a file against the expected value or <file>.sha256 (sha256sum format)
+function(cmkr_verify_sha256 file expected result)
+    set("${result}" OFF PARENT_SCOPE)
+    if(NOT expected AND EXISTS "${file}.sha256")
+        file(STRINGS "${file}.sha256" expected LIMIT_COUNT 1)
+        string(REGEX MATCH "^[0-9A-Fa-f]+" expected "${expected}")
+    endif()
+    if(NOT expected)
+        message(AUTHOR_WARNING "[cmkr] No SHA256 available for '${file}'")
+        return()
+    endif()
+    string(TOLOWER "${expected}" expected)
+    file(SHA256 "${file}" actual)
+    if(NOT actual STREQUAL expected)
+        message(AUTHOR_WARNING "[cmkr] SHA256 mismatch for '${file}' (expected ${expected}, got ${actual})")
+        return()
+    endif()
+    set("${result}" ON PARENT_SCOPE)
+endfunction()
+
+# Extracts an archive into an empty directory, the result is the directory or its only subdirectory
+function(cmkr_extract archive directory result)
+    file(REMOVE_RECURSE "${directory}")
+    file(MAKE_DIRECTORY "${directory}")
+    cmkr_exec("${CMAKE_COMMAND}" -E tar xf "${archive}"
+        WORKING_DIRECTORY "${directory}"
+    )
+    file(GLOB entries "${directory}/*")
+    list(LENGTH entries entry_count)
+    if(entry_count EQUAL 1 AND IS_DIRECTORY "${entries}")
+        set("${result}" "${entries}" PARENT_SCOPE)
+    else()
+        set("${result}" "${directory}" PARENT_SCOPE)
+    endif()
+endfunction()
+
+# Installs a verified prebuilt binary for this tag and host as CMKR_CACHED_EXECUTABLE
+function(cmkr_install_prebuilt result)
+    set("${result}" OFF PARENT_SCOPE)
+    if(NOT CMKR_PREBUILT_DIR)
+        return()
+    endif()
+    set(binary "${CMKR_PREBUILT_DIR}/${CMKR_TAG}/${CMKR_HOST}/${CMKR_EXECUTABLE_NAME}")
+    set(archive "")
+    foreach(extension .tar.gz .zip)
+        if(EXISTS "${CMKR_PREBUILT_DIR}/cmkr-${CMKR_TAG}-${CMKR_HOST}${extension}")
+            set(archive "${CMKR_PREBUILT_DIR}/cmkr-${CMKR_TAG}-${CMKR_HOST}${extension}")
+            break()
+        endif()
+    endforeach()
+
+    if(EXISTS "${binary}")
+        cmkr_verify_sha256("${binary}" "${CMKR_PREBUILT_SHA256}" verified)
+    elseif(archive)
+        cmkr_verify_sha256("${archive}" "${CMKR_PREBUILT_SHA256}" verified)
+        if(verified)
+            cmkr_extract("${archive}" "${CMKR_DIRECTORY}/prebuilt" extracted)
+            file(GLOB_RECURSE binary "${extracted}/${CMKR_EXECUTABLE_NAME}")
+            if(binary)
+                list(GET binary 0 binary)
+            endif()
+        endif()
+    else()
+        message(VERBOSE "[cmkr] No prebuilt cmkr ${CMKR_TAG} for ${CMKR_HOST} in '${CMKR_PREBUILT_DIR}'")
+        return()
+    endif()
+    if(NOT verified OR NOT binary OR NOT EXISTS "${binary}")
+        message(AUTHOR_WARNING "[cmkr] Ignoring prebuilt cmkr in '${CMKR_PREBUILT_DIR}'")
+        return()
+    endif()
+
+    message(STATUS "[cmkr] Using prebuilt cmkr: '${binary}'")
+    file(COPY "${binary}" DESTINATION "${CMKR_DIRECTORY}/bin")
+    file(REMOVE_RECURSE "${CMKR_DIRECTORY}/prebuilt")
+    set("${result}" ON PARENT_SCOPE)
+endfunction()
+
 # Helper function to check if a string starts with a prefix
 # Cannot use MATCHES, see: https://github.com/build-cpp/cmkr/issues/61
 function(cmkr_startswith str prefix result)
@@ -127,50 +218,64 @@ else()
     set(CMKR_EXECUTABLE "${CMKR_CACHED_EXECUTABLE}" CACHE FILEPATH "Full path to cmkr executable" FORCE)
     message(VERBOSE "[cmkr] Bootstrapping '${CMKR_EXECUTABLE}'")
 
-    message(STATUS "[cmkr] Fetching cmkr...")
     if(EXISTS "${CMKR_DIRECTORY}")
         cmkr_exec("${CMAKE_COMMAND}" -E rm -rf "${CMKR_DIRECTORY}")
     endif()
-    find_package(Git QUIET REQUIRED)
-    cmkr_exec("${GIT_EXECUTABLE}"
-        clone
-        --config advice.detachedHead=false
-        --branch ${CMKR_TAG}
-        --depth 1
-        ${CMKR_REPO}
-        "${CMKR_DIRECTORY}"
-    )
-    if(CMKR_COMMIT_HASH)
-        execute_process(
-            COMMAND "${GIT_EXECUTABLE}" checkout -q "${CMKR_COMMIT_HASH}"
-            RESULT_VARIABLE CMKR_EXEC_RESULT
-            WORKING_DIRECTORY "${CMKR_DIRECTORY}"
-        )
-        if(NOT CMKR_EXEC_RESULT EQUAL 0)
-            message(FATAL_ERROR "Tag '${CMKR_TAG}' hash is not '${CMKR_COMMIT_HASH}'")
+    cmkr_install_prebuilt(CMKR_PREBUILT_INSTALLED)
+    if(NOT CMKR_PREBUILT_INSTALLED)
+        file(REMOVE_RECURSE "${CMKR_DIRECTORY}")
+        if(CMKR_SOURCE_ARCHIVE)
+            message(STATUS "[cmkr] Extracting '${CMKR_SOURCE_ARCHIVE}'...")
+            cmkr_verify_sha256("${CMKR_SOURCE_ARCHIVE}" "${CMKR_SOURCE_ARCHIVE_SHA256}" CMKR_SOURCE_VERIFIED)
+            if(NOT CMKR_SOURCE_VERIFIED)
+                message(FATAL_ERROR "[cmkr] Failed to verify '${CMKR_SOURCE_ARCHIVE}'")
+            endif()
+            cmkr_extract("${CMKR_SOURCE_ARCHIVE}" "${CMKR_DIRECTORY}/source" CMKR_SOURCE_DIRECTORY)
+        else()
+            message(STATUS "[cmkr] Fetching cmkr...")
+            set(CMKR_SOURCE_DIRECTORY "${CMKR_DIRECTORY}")
+            find_package(Git QUIET REQUIRED)
+            cmkr_exec("${GIT_EXECUTABLE}"
+                clone
+                --config advice.detachedHead=false
+                --branch ${CMKR_TAG}
+                --depth 1
+                ${CMKR_REPO}
+                "${CMKR_DIRECTORY}"
+            )
+            if(CMKR_COMMIT_HASH)
+                execute_process(
+                    COMMAND "${GIT_EXECUTABLE}" checkout -q "${CMKR_COMMIT_HASH}"
+                    RESULT_VARIABLE CMKR_EXEC_RESULT
+                    WORKING_DIRECTORY "${CMKR_DIRECTORY}"
+                )
+                if(NOT CMKR_EXEC_RESULT EQUAL 0)
+                    message(FATAL_ERROR "Tag '${CMKR_TAG}' hash is not '${CMKR_COMMIT_HASH}'")
+                endif()
+            endif()
         endif()
+        message(STATUS "[cmkr] Building cmkr (using system compiler)...")
+        cmkr_exec("${CMAKE_COMMAND}"
+            --no-warn-unused-cli
+            "${CMKR_SOURCE_DIRECTORY}"
+            "-B${CMKR_DIRECTORY}/build"
+            "-DCMAKE_BUILD_TYPE=${CMKR_BUILD_TYPE}"
+            "-DCMAKE_UNITY_BUILD=ON"
+            "-DCMAKE_INSTALL_PREFIX=${CMKR_DIRECTORY}"
+            "-DCMKR_GENERATE_DOCUMENTATION=OFF"
+        )
+        cmkr_exec("${CMAKE_COMMAND}"
+            --build "${CMKR_DIRECTORY}/build"
+            --config "${CMKR_BUILD_TYPE}"
+            --parallel
+        )
+        cmkr_exec("${CMAKE_COMMAND}"
+            --install "${CMKR_DIRECTORY}/build"
+            --config "${CMKR_BUILD_TYPE}"
+            --prefix "${CMKR_DIRECTORY}"
+            --component cmkr
+        )
     endif()
-    message(STATUS "[cmkr] Building cmkr (using system compiler)...")
-    cmkr_exec("${CMAKE_COMMAND}"
-        --no-warn-unused-cli
-        "${CMKR_DIRECTORY}"
-        "-B${CMKR_DIRECTORY}/build"
-        "-DCMAKE_BUILD_TYPE=${CMKR_BUILD_TYPE}"
-        "-DCMAKE_UNITY_BUILD=ON"
-        "-DCMAKE_INSTALL_PREFIX=${CMKR_DIRECTORY}"
-        "-DCMKR_GENERATE_DOCUMENTATION=OFF"
-    )
-    cmkr_exec("${CMAKE_COMMAND}"
-        --build "${CMKR_DIRECTORY}/build"
-        --config "${CMKR_BUILD_TYPE}"
-        --parallel
-    )
-    cmkr_exec("${CMAKE_COMMAND}"
-        --install "${CMKR_DIRECTORY}/build"
-        --config "${CMKR_BUILD_TYPE}"
-        --prefix "${CMKR_DIRECTORY}"
-        --component cmkr
-    )
     if(NOT EXISTS ${CMKR_EXECUTABLE})
         message(FATAL_ERROR "[cmkr] Failed to bootstrap '${CMKR_EXECUTABLE}'")
     endif()
@@ -179,10 +284,72 @@ else()
 endif()
 execute_process(COMMAND "${CMKR_EXECUTABLE}" version
     RESULT_VARIABLE CMKR_EXEC_RESULT
+    ERROR_VARIABLE CMKR_VERSION
+    ERROR_STRIP_TRAILING_WHITESPACE
 )
 if(NOT CMKR_EXEC_RESULT EQUAL 0)
     message(FATAL_ERROR "[cmkr] Failed to get version, try clearing the cache and rebuilding")
 endif()
+string(REPLACE "[cmkr] " "" CMKR_VERSION "${CMKR_VERSION}")
+message(STATUS "[cmkr] ${CMKR_VERSION}")
+
+# Older versions do not have cmkr gen --cache-dir, checked once per executable and version
+if(NOT CMKR_CACHE_DIR_CHECKED STREQUAL "${CMKR_EXECUTABLE};${CMKR_VERSION}")
+    execute_process(COMMAND "${CMKR_EXECUTABLE}" help
+        OUTPUT_VARIABLE CMKR_HELP
+        ERROR_VARIABLE CMKR_HELP
+    )
+    set(CMKR_CACHE_DIR OFF)
+    if(CMKR_HELP MATCHES "--cache-dir")
+        set(CMKR_CACHE_DIR ON)
+    endif()
+    set(CMKR_CACHE_DIR ${CMKR_CACHE_DIR} CACHE INTERNAL "")
+    set(CMKR_CACHE_DIR_CHECKED "${CMKR_EXECUTABLE};${CMKR_VERSION}" CACHE INTERNAL "")
+endif()
+
+# Checks the stamp written by the last cmkr gen, the result is ON if nothing changed since
+function(cmkr_stamp_valid stamp_file result)
+    set("${result}" OFF PARENT_SCOPE)
+    if(NOT EXISTS "${stamp_file}" OR "${CMKR_EXECUTABLE}" IS_NEWER_THAN "${stamp_file}")
+        return()
+    endif()
+    include("${stamp_file}")
+    if(NOT CMKR_STAMP_VERSION STREQUAL CMKR_VERSION)
+        return()
+    endif()
+    # The lists contain path/value pairs
+    set(CMKR_STAMP_PATH "")
+    foreach(CMKR_STAMP_ITEM IN LISTS CMKR_STAMP_FILES)
+        if(CMKR_STAMP_PATH STREQUAL "")
+            set(CMKR_STAMP_PATH "${CMKR_STAMP_ITEM}")
+            continue()
+        endif()
+        set(CMKR_STAMP_HASH "-")
+        if(EXISTS "${CMKR_STAMP_PATH}")
+            file(SHA256 "${CMKR_STAMP_PATH}" CMKR_STAMP_HASH)
+        endif()
+        if(NOT CMKR_STAMP_HASH STREQUAL CMKR_STAMP_ITEM)
+            return()
+        endif()
+        set(CMKR_STAMP_PATH "")
+    endforeach()
+    foreach(CMKR_STAMP_ITEM IN LISTS CMKR_STAMP_DIRECTORIES)
+        if(CMKR_STAMP_PATH STREQUAL "")
+            set(CMKR_STAMP_PATH "${CMKR_STAMP_ITEM}")
+            continue()
+        endif()
+        if(CMKR_STAMP_ITEM STREQUAL "racy")
+            message(VERBOSE "[cmkr] Generating, ${CMKR_STAMP_PATH} was modified during the last generation")
+            return()
+        endif()
+        file(TIMESTAMP "${CMKR_STAMP_PATH}" CMKR_STAMP_TIMESTAMP "%s" UTC)
+        if(NOT CMKR_STAMP_TIMESTAMP STREQUAL CMKR_STAMP_ITEM)
+            return()
+        endif()
+        set(CMKR_STAMP_PATH "")
+    endforeach()
+    set("${result}" ON PARENT_SCOPE)
+endfunction()
 
 # Use cmkr.cmake as a script
 if(CMAKE_SCRIPT_MODE_FILE)
@@ -223,10 +390,22 @@ macro(cmkr)
 
         file(SHA256 "${CMAKE_CURRENT_LIST_FILE}" CMKR_LIST_FILE_SHA256_PRE)
 
-        # Generate CMakeLists.txt
-        cmkr_exec("${CMKR_EXECUTABLE}" gen
-            WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
-        )
+        # Generate CMakeLists.txt (the manifest in the cache directory skips unchanged directories)
+        set(CMKR_STAMP_VALID OFF)
+        if(CMKR_CACHE_DIR)
+            cmkr_stamp_valid("${CMAKE_CURRENT_BINARY_DIR}/cmkr-cache/cmkr-stamp.cmake" CMKR_STAMP_VALID)
+        endif()
+        if(CMKR_STAMP_VALID)
+            message(VERBOSE "[cmkr] Skipping generation, cmake.toml is unchanged")
+        elseif(CMKR_CACHE_DIR)
+            cmkr_exec("${CMKR_EXECUTABLE}" gen --cache-dir "${CMAKE_CURRENT_BINARY_DIR}/cmkr-cache"
+                WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+            )
+        else()
+            cmkr_exec("${CMKR_EXECUTABLE}" gen
+                WORKING_DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}"
+            )
+        endif()
 
         file(SHA256 "${CMAKE_CURRENT_LIST_FILE}" CMKR_LIST_FILE_SHA256_POST)
 
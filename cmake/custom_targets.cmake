@@ -1,4 +1,4 @@
-generate_resources(cmkr)
+generate_resources(cmkr_lib)
 
 add_custom_target(regenerate-cmake
         COMMAND "$<TARGET_FILE:cmkr>" gen
@@ -16,3 +16,7 @@ else()
             WORKING_DIRECTORY "${PROJECT_BINARY_DIR}/tests"
     )
 endif()
+
+# The toml11 parser (src/toml_parser.cpp) takes the longest to compile, keep it out of the
+# unity batches so it builds in parallel with the rest of cmkr
+set_source_files_properties(src/toml_parser.cpp PROPERTIES SKIP_UNITY_BUILD_INCLUSION ON)
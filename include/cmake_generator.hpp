@@ -1,13 +1,55 @@
 #pragma once
 
+#include "directory_cache.hpp"
+#include "manifest.hpp"
 #include "project_parser.hpp"
+#include "trace.hpp"
+
+#include <string>
+#include <vector>
 
 namespace cmkr {
 namespace gen {
 
+// A file generated by cmkr gen
+struct OutputFile {
+    std::string path;
+    std::string contents;
+    // The file did not exist or had different contents
+    bool changed = false;
+};
+
+// State kept in memory between the generations of cmkr watch
+struct Session {
+    dircache::DirectoryCache directories;
+    // Inputs of the last successful generation (empty before the first one)
+    manifest::Manifest manifest;
+    // Every directory with a cmake.toml the last generation reached, also when it failed
+    std::vector<std::string> visited;
+};
+
+struct Options {
+    // Number of subdirectories generated concurrently (0 = hardware threads)
+    unsigned int jobs = 0;
+    // Directory for the incremental generation manifest (empty = disabled)
+    std::string cache_dir;
+    // Incremental generation in memory instead, cache_dir is not used (cmkr watch)
+    Session *session = nullptr;
+    // Print how many directory reads and stat calls the directory cache saved
+    bool stats = false;
+    // Write a Chrome trace of the generation phases to this file and print a summary (empty = disabled)
+    std::string trace;
+    // Record the trace events into this recorder instead, without writing or printing them (used by cmkr_bench)
+    trace::Recorder *recorder = nullptr;
+    // Write the changed files, otherwise nothing is written (requires an empty cache_dir)
+    bool write = true;
+    // Report the generated files here, depth-first in the order of the subdirectories
+    std::vector<OutputFile> *outputs = nullptr;
+};
+
 void generate_project(const std::string &type);
 
-void generate_cmake(const char *path, const parser::Project *parent_project = nullptr);
+void generate_cmake(const char *path, const Options &options = Options());
 
 } // namespace gen
 } // namespace cmkr
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace diag {
+
+enum Severity {
+    severity_warning,
+    severity_error,
+};
+
+struct Diagnostic {
+    Severity severity = severity_error;
+    // First line of the text, without the [warning] or [error] prefix
+    std::string message;
+    // Location in a cmake.toml (empty and 0 when unknown)
+    std::string file;
+    size_t line = 0;
+    size_t column = 0;
+    // Full text, as printed by the cmkr executable
+    std::string text;
+
+    Diagnostic() = default;
+    Diagnostic(Severity severity, std::string text);
+};
+
+// An error that points to a location in a cmake.toml
+class Error : public std::runtime_error {
+    Diagnostic m_diagnostic;
+
+  public:
+    explicit Error(Diagnostic diagnostic);
+
+    const Diagnostic &diagnostic() const {
+        return m_diagnostic;
+    }
+};
+
+// Prints the warning to stdout, unless a Collector is active. Thread-safe.
+void warning(Diagnostic diagnostic);
+
+// Collects the warnings instead of printing them for as long as it exists. Only one
+// collector can be active at a time.
+class Collector {
+    std::vector<Diagnostic> m_diagnostics;
+
+  public:
+    Collector();
+    ~Collector();
+    Collector(const Collector &) = delete;
+
+    // Returns the collected warnings in the order they were reported
+    std::vector<Diagnostic> take();
+};
+
+} // namespace diag
+} // namespace cmkr
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "fs.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <tsl/ordered_map.h>
+
+namespace cmkr {
+namespace dircache {
+
+struct Entry {
+    std::string name;
+    // Symbolic links are followed
+    bool is_directory = false;
+    bool is_symlink = false;
+};
+
+struct Snapshot {
+    bool exists = false;
+    // Last write time of the directory, used to revalidate a persisted snapshot
+    long long mtime = 0;
+    // Modified too recently to trust the mtime on the next run
+    bool racy = false;
+    // Sorted by name
+    std::vector<Entry> entries;
+};
+
+struct Stats {
+    // Directories that were read from the filesystem
+    size_t readdir_calls = 0;
+    // Directory reads answered from memory or a persisted snapshot
+    size_t readdir_saved = 0;
+    // Entry type and directory mtime queries
+    size_t stat_calls = 0;
+    // Entry type queries answered from a snapshot
+    size_t stat_saved = 0;
+    // File existence checks, and the ones that still needed a stat
+    size_t exists_checks = 0;
+    size_t exists_calls = 0;
+};
+
+// Walks each directory at most once per run and shares the result between all
+// targets, templates and installs. Thread-safe.
+class DirectoryCache {
+    mutable std::mutex m_mutex;
+    tsl::ordered_map<std::string, std::shared_ptr<const Snapshot>> m_snapshots;
+    // Loaded from the previous run, only used after the mtime is checked
+    tsl::ordered_map<std::string, std::shared_ptr<const Snapshot>> m_persisted;
+    // File hashes by directory and file name
+    tsl::ordered_map<std::string, tsl::ordered_map<std::string, std::string>> m_hashes;
+    Stats m_stats;
+
+    std::shared_ptr<const Snapshot> read(const fs::path &directory, const std::string &key);
+    std::shared_ptr<const Snapshot> lookup(const fs::path &directory, bool count_saved);
+
+  public:
+    std::shared_ptr<const Snapshot> list(const fs::path &directory);
+
+    // Answered from the listing of the parent directory. Only misses (and paths
+    // the listing cannot answer reliably) are confirmed with fs::exists, so case
+    // insensitive filesystems and broken symbolic links behave like before.
+    bool exists(const fs::path &file);
+
+    // Hashes of file contents computed by the manifest, so unchanged files are only
+    // read once while cmkr watch is running
+    bool file_hash(const fs::path &file, std::string &hash) const;
+    void set_file_hash(const fs::path &file, const std::string &hash);
+
+    // Forget the listing of a directory and the hashes of its files, the next
+    // lookup reads them again. Used by cmkr watch when the directory changed, the
+    // path has to be spelled like the generation did (relative or absolute).
+    void invalidate(const fs::path &directory);
+
+    bool load(const fs::path &file);
+    void save(const fs::path &file) const;
+
+    Stats stats() const;
+};
+
+} // namespace dircache
+} // namespace cmkr
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tsl/ordered_map.h>
+
+namespace cmkr {
+namespace gen {
+
+// Append-only output buffer for the generated CMake code. Arguments are
+// written (and quoted) in place, so emitting does not allocate per argument.
+class Buffer {
+    std::string m_data;
+
+  public:
+    void reserve(size_t size) {
+        m_data.reserve(size);
+    }
+
+    // Keeps the capacity, so the buffer can be reused
+    void clear() {
+        m_data.clear();
+    }
+
+    const std::string &str() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_data.size();
+    }
+
+    Buffer &operator<<(char ch) {
+        m_data += ch;
+        return *this;
+    }
+
+    Buffer &operator<<(const char *str) {
+        m_data.append(str);
+        return *this;
+    }
+
+    Buffer &operator<<(const std::string &str) {
+        m_data.append(str);
+        return *this;
+    }
+
+    void indent(int depth) {
+        if (depth > 0) {
+            m_data.append(static_cast<size_t>(depth), '\t');
+        }
+    }
+
+    // Appends the argument, quoted and escaped if CMake requires it
+    void quoted(const char *str, size_t size);
+};
+
+struct CommandEndl {
+    Buffer &ss;
+    explicit CommandEndl(Buffer &ss) : ss(ss) {
+    }
+    void endl() {
+        ss << '\n';
+    }
+};
+
+struct RawArg {
+    RawArg() = default;
+    explicit RawArg(std::string arg) : arg(std::move(arg)) {
+    }
+
+    std::string arg;
+
+    bool empty() const {
+        return arg.empty();
+    }
+};
+
+// Credit: JustMagic
+struct Command {
+    Buffer &ss;
+    int depth = 0;
+    std::string command;
+    bool first_arg = true;
+    bool had_newline = false;
+    bool generated = false;
+    std::string post_comment;
+
+    Command(Buffer &ss, int depth, std::string command, std::string post_comment)
+        : ss(ss), depth(depth), command(std::move(command)), post_comment(std::move(post_comment)) {
+    }
+
+    ~Command() noexcept(false) {
+        if (!generated) {
+            throw std::runtime_error("Incorrect usage of cmd(), you probably forgot ()");
+        }
+    }
+
+    static std::string quote(const std::string &str) {
+        Buffer buffer;
+        buffer.quoted(str.data(), str.size());
+        return buffer.str();
+    }
+
+    template <class T>
+    bool print_arg(const std::vector<T> &vec) {
+        if (vec.empty()) {
+            return true;
+        }
+
+        had_newline = true;
+        for (const auto &value : vec) {
+            print_arg(value);
+        }
+
+        return true;
+    }
+
+    template <class Key, class Value>
+    bool print_arg(const tsl::ordered_map<Key, Value> &map) {
+        if (map.empty()) {
+            return true;
+        }
+
+        for (const auto &itr : map) {
+            print_arg(itr);
+        }
+
+        return true;
+    }
+
+    template <class K>
+    bool print_arg(const std::pair<K, std::vector<std::string>> &kv) {
+        if (kv.second.empty()) {
+            return true;
+        }
+
+        had_newline = true;
+        print_arg(kv.first);
+        depth++;
+        for (const auto &s : kv.second) {
+            print_arg(s);
+        }
+        depth--;
+
+        return true;
+    }
+
+    template <class K, class V>
+    bool print_arg(const std::pair<K, V> &kv) {
+        if (kv.second.empty()) {
+            return true;
+        }
+
+        had_newline = true;
+        print_arg(kv.first);
+        depth++;
+        print_arg(kv.second);
+        depth--;
+
+        return true;
+    }
+
+    void separator() {
+        if (had_newline) {
+            first_arg = false;
+            ss << '\n';
+            ss.indent(depth + 1);
+        } else if (first_arg) {
+            first_arg = false;
+        } else {
+            ss << ' ';
+        }
+    }
+
+    bool print_arg(const RawArg &arg) {
+        if (arg.empty()) {
+            return true;
+        }
+
+        separator();
+        ss << arg.arg;
+        return true;
+    }
+
+    bool print_string(const char *str, size_t size) {
+        if (size == 0) {
+            return true;
+        }
+
+        separator();
+        ss.quoted(str, size);
+        return true;
+    }
+
+    bool print_arg(const std::string &str) {
+        return print_string(str.data(), str.size());
+    }
+
+    bool print_arg(const char *str) {
+        return print_string(str, strlen(str));
+    }
+
+    template <class... Ts>
+    CommandEndl operator()(Ts &&...values) {
+        generated = true;
+        ss.indent(depth);
+        ss << command << '(';
+        (void)std::initializer_list<bool>{print_arg(values)...};
+        if (had_newline) {
+            ss << '\n';
+            ss.indent(depth);
+        }
+        ss << ')';
+        if (!post_comment.empty()) {
+            ss << " # " << post_comment;
+        }
+        ss << '\n';
+        return CommandEndl(ss);
+    }
+};
+
+} // namespace gen
+} // namespace cmkr
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "fs.hpp"
+
+#include <string>
+
+namespace cmkr {
+namespace files {
+
+// Reads the whole file, returns false if it cannot be opened
+bool try_read(const fs::path &path, std::string &contents);
+
+// Throws if the file cannot be read
+std::string read(const fs::path &path);
+
+// Returns true if the file exists and has exactly these contents. The size is
+// compared first, the contents are only read (mapped in chunks) if it matches.
+bool equals(const fs::path &path, const std::string &contents);
+
+// Writes to a temporary file in the same directory and renames it over the
+// destination, so concurrent readers (CMake, IDEs) never see a partial file.
+// Parent directories are created as needed.
+void write(const fs::path &path, const std::string &contents);
+
+// Only writes the file if the contents changed, returns true if it was written
+bool update(const fs::path &path, const std::string &contents);
+
+} // namespace files
+} // namespace cmkr
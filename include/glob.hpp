@@ -0,0 +1,88 @@
+#pragma once
+
+#include "directory_cache.hpp"
+#include "fs.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace glob {
+
+// Returns true if the path contains glob syntax (*, ?, [ or {). Paths that
+// contain CMake variables or generator expressions are never globbed.
+bool is_pattern(const std::string &path);
+
+// Expands {a,b} alternatives, nested braces are supported
+std::vector<std::string> expand_braces(const std::string &pattern);
+
+// Matches a single path component against *, ? and [abc], [a-z], [!a] classes
+bool match_component(const std::string &pattern, const std::string &name);
+
+// A set of glob patterns that is evaluated in a single pass over the directory
+// tree. Besides the usual syntax, ** matches any number of directories and the
+// legacy form dir/**.ext is equivalent to dir/**/*.ext.
+class Matcher {
+  public:
+    struct Component {
+        std::string text;
+        bool recursive = false;
+        bool literal = false;
+    };
+
+  private:
+    struct Pattern {
+        size_t source = 0;
+        std::vector<Component> components;
+        // Ended with **, so it matches everything below a directory
+        bool subtree = false;
+    };
+
+    std::vector<Pattern> m_patterns;
+    std::vector<Pattern> m_excludes;
+    std::vector<std::string> m_ignore_files;
+    size_t m_sources = 0;
+
+    static std::vector<Pattern> compile(const std::string &pattern, size_t source);
+    bool excluded(const std::vector<std::string> &parts) const;
+    bool pruned(const std::vector<std::string> &parts) const;
+
+  public:
+    struct Result {
+        // Files relative to the root, indexed by the value returned from add(). Paths
+        // through symbolic links are resolved (like fs::relative).
+        std::vector<std::vector<fs::path>> matches;
+        // Every directory that was listed, relative to the root
+        std::vector<fs::path> directories;
+        // Ignore files that were read, relative to the root
+        std::vector<fs::path> ignore_files;
+    };
+
+    // Returns the index of the pattern in Result::matches
+    size_t add(const std::string &pattern);
+
+    // Paths that match an exclusion are removed from the results. Directories
+    // that match the part before a trailing /** are not walked at all.
+    void exclude(const std::string &pattern);
+
+    // Names of files with .gitignore syntax (a subset) to honour while walking.
+    // Only ignore files in the root directory and below are read.
+    void ignore_files(const std::vector<std::string> &names);
+
+    bool excluded(const fs::path &path) const;
+
+    bool empty() const {
+        return m_patterns.empty();
+    }
+
+    // Returns true if the pattern (or one of its alternatives) starts with **
+    bool starts_recursive(size_t source) const;
+
+    // Throws if the directory before the first wildcard of a pattern does not exist
+    Result expand(dircache::DirectoryCache &directories, pool::ThreadPool &pool, const fs::path &root) const;
+};
+
+} // namespace glob
+} // namespace cmkr
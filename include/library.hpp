@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cmake_generator.hpp"
+#include "diagnostics.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace lib {
+
+struct Options {
+    // Write the changed files, by default nothing is written
+    bool write = false;
+    // Generator settings (jobs, cache_dir, stats, trace), its write and outputs are set by the library
+    gen::Options generator;
+};
+
+struct Result {
+    bool success = false;
+    // Contents of the root CMakeLists.txt (empty if the generation failed)
+    std::string cmakelists;
+    // Every generated file, including the root CMakeLists.txt (empty if the generation failed)
+    std::vector<gen::OutputFile> files;
+    // The warnings in the order they were reported, followed by the error that stopped the generation
+    std::vector<diag::Diagnostic> diagnostics;
+};
+
+// Generates the project in a directory without throwing. Generations are serialized (the
+// cmake.toml documents and the warnings are process-wide), the subdirectories of a single
+// project are still generated concurrently.
+Result generate(const std::string &path, const Options &options = Options());
+
+// Same as generate, but the cmake.toml of the directory is replaced with these contents.
+// Sources and subdirectories are still looked up relative to the directory.
+Result generate_toml(const std::string &path, const std::string &toml, const Options &options = Options());
+
+} // namespace lib
+} // namespace cmkr
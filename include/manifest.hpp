@@ -0,0 +1,88 @@
+#pragma once
+
+#include "directory_cache.hpp"
+#include "fs.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tsl/ordered_map.h>
+
+namespace cmkr {
+namespace manifest {
+
+// 64-bit FNV-1a, only used to detect changes between runs
+uint64_t hash(const char *data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+std::string hash_string(const std::string &data);
+
+// Returns "-" if the file does not exist
+std::string hash_file(const fs::path &path);
+
+// Hash of the names (and types) of the entries in a directory and of the targets of its
+// symbolic links, "-" if it does not exist
+std::string hash_listing(dircache::DirectoryCache &directories, const fs::path &directory);
+
+struct Subdir {
+    std::string key;
+    // Only set for subdirectories that were not generated (missing cmake.toml or a [project])
+    std::string toml;
+    bool generated = false;
+};
+
+// Inputs and outputs of a single generated directory. All paths are relative to the directory.
+struct Directory {
+    // Hash of the cmake.toml files of all the parent directories
+    std::string scope;
+    std::string toml;
+    // Directories whose contents were used during generation (globs, existence checks)
+    tsl::ordered_map<std::string, std::string> listings;
+    // Files other than cmake.toml that were read (ignore files)
+    tsl::ordered_map<std::string, std::string> inputs;
+    tsl::ordered_map<std::string, std::string> outputs;
+    std::vector<Subdir> subdirs;
+
+    void add_listing(dircache::DirectoryCache &directories, const fs::path &root, const fs::path &directory);
+    void add_input(const fs::path &root, const fs::path &file);
+    void add_output(const fs::path &root, const fs::path &file);
+    bool up_to_date(dircache::DirectoryCache &directories, const fs::path &root) const;
+};
+
+class Manifest {
+    tsl::ordered_map<std::string, Directory> m_directories;
+    tsl::ordered_map<std::string, bool> m_up_to_date;
+    tsl::ordered_map<std::string, bool> m_directory_up_to_date;
+
+  public:
+    // Directory keys are relative to the root project, the root is "."
+    static std::string subdir_key(const std::string &parent, const fs::path &sub);
+    static std::string subdir_scope(const std::string &parent_scope, const std::string &parent_toml);
+
+    bool load(const fs::path &file);
+    void save(const fs::path &file) const;
+
+    const Directory *find(const std::string &key) const;
+    const tsl::ordered_map<std::string, Directory> &directories() const {
+        return m_directories;
+    }
+    void insert(const std::string &key, const Directory &directory);
+
+    // Copy the records of a directory and all of its subdirectories
+    void copy_tree(const Manifest &other, const std::string &key);
+
+    // Checks which directory trees have unchanged inputs. This does not parse
+    // anything, it only hashes files and directory listings.
+    void validate(dircache::DirectoryCache &directories, const fs::path &root_path);
+
+    // Only valid after validate(), the scope is checked separately because it
+    // depends on the (possibly regenerated) parent directory
+    bool tree_up_to_date(const std::string &key, const std::string &scope) const;
+
+    // Only the files of the directory itself are unchanged, the subdirectories
+    // it generates are the same but some of them have to be generated again
+    bool directory_up_to_date(const std::string &key, const std::string &scope) const;
+};
+
+} // namespace manifest
+} // namespace cmkr
@@ -1,7 +1,10 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mpark/variant.hpp>
 #include <tsl/ordered_map.h>
@@ -10,8 +13,91 @@
 namespace cmkr {
 namespace parser {
 
+// Values keyed by condition name ("" is unconditional), in insertion order. Almost all of
+// them are empty or hold a single condition, so a vector is searched linearly instead of
+// paying for a hash table (which allocates even when empty) per target property.
 template <typename T>
-using Condition = tsl::ordered_map<std::string, T>;
+class Condition {
+  public:
+    using value_type = std::pair<std::string, T>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  private:
+    std::vector<value_type> m_values;
+
+  public:
+    iterator begin() {
+        return m_values.begin();
+    }
+    iterator end() {
+        return m_values.end();
+    }
+    const_iterator begin() const {
+        return m_values.begin();
+    }
+    const_iterator end() const {
+        return m_values.end();
+    }
+
+    bool empty() const {
+        return m_values.empty();
+    }
+    size_t size() const {
+        return m_values.size();
+    }
+
+    iterator find(const std::string &condition) {
+        for (auto itr = m_values.begin(); itr != m_values.end(); ++itr) {
+            if (itr->first == condition) {
+                return itr;
+            }
+        }
+        return m_values.end();
+    }
+    const_iterator find(const std::string &condition) const {
+        for (auto itr = m_values.begin(); itr != m_values.end(); ++itr) {
+            if (itr->first == condition) {
+                return itr;
+            }
+        }
+        return m_values.end();
+    }
+
+    bool contains(const std::string &condition) const {
+        return find(condition) != end();
+    }
+    size_t count(const std::string &condition) const {
+        return contains(condition) ? 1 : 0;
+    }
+
+    const T &at(const std::string &condition) const {
+        auto itr = find(condition);
+        if (itr == m_values.end()) {
+            throw std::out_of_range("Condition '" + condition + "' not found");
+        }
+        return itr->second;
+    }
+
+    // Like std::map::insert, conditions that are already present are not overwritten
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            if (!contains(first->first)) {
+                m_values.emplace_back(first->first, first->second);
+            }
+        }
+    }
+
+    T &operator[](const std::string &condition) {
+        auto itr = find(condition);
+        if (itr != m_values.end()) {
+            return itr->second;
+        }
+        m_values.emplace_back(condition, T());
+        return m_values.back().second;
+    }
+};
 
 using ConditionVector = Condition<std::vector<std::string>>;
 
@@ -73,6 +159,56 @@ enum TargetType {
 
 extern const char *targetTypeNames[target_last];
 
+enum UnityMode {
+    unity_batch,
+    unity_group,
+    unity_last,
+};
+
+extern const char *unityModeNames[unity_last];
+
+// [[target.<name>.bolt.training]], a run of the instrumented executable
+struct BoltTraining {
+    std::vector<std::string> arguments;
+    std::string working_directory;
+};
+
+// [target.<name>.bolt], post-link optimization of an executable with llvm-bolt
+struct Bolt {
+    // Set by bolt = true/false or a bolt table (which enables it unless enable = false)
+    bool specified = false;
+    bool enable = false;
+    // Passed to llvm-bolt when optimizing, empty = the default layout options
+    std::vector<std::string> options;
+    // The [[install]] of the target installs <target>.bolt instead
+    bool install = false;
+    std::vector<BoltTraining> training;
+};
+
+enum LtoMode {
+    lto_off,
+    lto_full,
+    lto_thin,
+    lto_last,
+};
+
+extern const char *ltoModeNames[lto_last];
+
+LtoMode parse_ltoMode(const std::string &name);
+
+// [target.<name>.unity], the settings that are not specified are left to CMake
+struct Unity {
+    // Set by unity = true/false or a unity table (which enables it unless enable = false)
+    bool specified = false;
+    bool enable = true;
+    // -1 if not specified, 0 puts all the sources in a single unity source
+    int batch_size = -1;
+    // unity_last if not specified. Group mode groups the sources by directory.
+    UnityMode mode = unity_last;
+    // Sources (and globs) that are compiled on their own
+    std::vector<std::string> exclude;
+};
+
 struct Target {
     std::string name;
     TargetType type = target_last;
@@ -110,6 +246,12 @@ struct Target {
     std::string condition;
     std::string alias;
     Condition<tsl::ordered_map<std::string, std::string>> properties;
+    Unity unity;
+    // Validated lto mode names (off, full, thin)
+    Condition<std::string> lto;
+    // Instrumented or optimized depending on the CMKR_PGO phase, see cmkr build --pgo
+    Condition<bool> pgo;
+    Bolt bolt;
 
     Condition<std::string> cmake_before;
     Condition<std::string> cmake_after;
@@ -175,6 +317,16 @@ enum MsvcRuntimeType {
 
 extern const char *msvcRuntimeTypeNames[msvc_last];
 
+enum CompilerLauncher {
+    launcher_none,
+    launcher_auto,
+    launcher_ccache,
+    launcher_sccache,
+    launcher_last,
+};
+
+extern const char *compilerLauncherNames[launcher_last];
+
 struct Project {
     const Project *parent;
 
@@ -185,6 +337,8 @@ struct Project {
     std::string generator;
     std::string config;
     bool allow_in_tree = false;
+    // Only used by the root project (and cmkr build)
+    CompilerLauncher compiler_launcher = launcher_none;
     Condition<std::vector<std::string>> project_subdirs;
     std::vector<std::string> cppflags;
     std::vector<std::string> cflags;
@@ -197,6 +351,9 @@ struct Project {
     ConditionVector project_languages;
     bool project_allow_unknown_languages = false;
     MsvcRuntimeType project_msvc_runtime = msvc_last;
+    // Default of the targets in this project and its subdirectories, see find_lto
+    LtoMode project_lto = lto_last;
+    std::vector<std::string> project_glob_ignore_files;
     Condition<std::string> cmake_before;
     Condition<std::string> cmake_after;
     ConditionVector include_before;
@@ -206,20 +363,43 @@ struct Project {
     std::vector<Package> packages;
     Vcpkg vcpkg;
     std::vector<Content> contents;
+    // Only the templates declared in this project, see find_template
     std::vector<Template> templates;
     std::vector<Target> targets;
     std::vector<Test> tests;
+    // [[pgo-training]], tests that only run in the instrumented (CMKR_PGO=generate) build
+    std::vector<Test> pgo_trainings;
     std::vector<Install> installs;
+    // Only the conditions declared (or overridden) in this project, see find_condition
     tsl::ordered_map<std::string, std::string> conditions;
     std::vector<Subdir> subdirs;
 
     Project(const Project *parent, const std::string &path, bool build);
     const Project *root() const;
+    // Looks up a condition in this project and then in its parents, nullptr if it is not defined
+    const std::string *find_condition(const std::string &name) const;
+    const Template *find_template(const std::string &name) const;
+    // The [project].lto of this project or the nearest parent that sets it, lto_last if none does
+    LtoMode find_lto() const;
     bool cmake_minimum_version(int major, int minor) const;
     static bool is_condition_name(const std::string &name);
 };
 
 bool is_root_path(const std::string &path);
 
+// Hash of the cmake.toml in a directory (same format as manifest::hash_file), "-" if it
+// does not exist. Every cmake.toml is read and parsed at most once per process, the hash
+// always matches the contents the project was parsed from.
+std::string toml_hash(const std::string &path);
+
+// Use these contents for the cmake.toml in a directory instead of reading the file
+void set_toml(const std::string &path, const std::string &contents);
+
+// Forget the cmake.toml in a directory, the next generation reads it again
+void forget_toml(const std::string &path);
+
+// Forget every cmake.toml read (or set) so far, the next generation reads them again
+void clear_documents();
+
 } // namespace parser
 } // namespace cmkr
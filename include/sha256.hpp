@@ -0,0 +1,36 @@
+#pragma once
+
+#include "fs.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cmkr {
+namespace sha256 {
+
+// Incremental SHA-256, produces the same digests as file(SHA256) in CMake
+class Hasher {
+    uint32_t m_state[8];
+    unsigned char m_block[64];
+    size_t m_block_size = 0;
+    uint64_t m_length = 0;
+
+    void transform(const unsigned char *block);
+
+  public:
+    Hasher();
+
+    void update(const void *data, size_t size);
+
+    // Lowercase hex digest, the hasher cannot be updated afterwards
+    std::string finish();
+};
+
+std::string hash_string(const std::string &data);
+
+// Returns "-" if the file cannot be read
+std::string hash_file(const fs::path &path);
+
+} // namespace sha256
+} // namespace cmkr
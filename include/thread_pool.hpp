@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cmkr {
+namespace pool {
+
+class TaskGroup;
+
+// Fixed set of worker threads that execute tasks submitted through a TaskGroup.
+// The thread waiting on a TaskGroup helps executing the queued tasks of that
+// group, so nested groups (a task that waits on its own group) cannot deadlock
+// the pool, even without worker threads.
+class ThreadPool {
+    struct Task {
+        TaskGroup *group;
+        std::function<void()> fn;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Task> m_queue;
+    std::vector<std::thread> m_workers;
+    unsigned int m_jobs = 1;
+    bool m_stop = false;
+
+    friend class TaskGroup;
+
+    void worker();
+    void execute(Task &task);
+
+  public:
+    // The calling thread counts as a job, jobs = 0 uses the hardware thread count
+    explicit ThreadPool(unsigned int jobs);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+
+    unsigned int jobs() const {
+        return m_jobs;
+    }
+};
+
+class TaskGroup {
+    ThreadPool &m_pool;
+    size_t m_pending = 0;
+    std::exception_ptr m_error;
+
+    friend class ThreadPool;
+
+  public:
+    explicit TaskGroup(ThreadPool &pool) : m_pool(pool) {
+    }
+    ~TaskGroup();
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup(TaskGroup &&) = delete;
+
+    ThreadPool &pool() const {
+        return m_pool;
+    }
+
+    // Tasks may call run() on their own group to schedule more work
+    void run(std::function<void()> fn);
+
+    // Blocks until every task of this group has finished and rethrows the
+    // first exception that escaped a task (if any)
+    void wait();
+};
+
+} // namespace pool
+} // namespace cmkr
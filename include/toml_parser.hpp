@@ -0,0 +1,29 @@
+#pragma once
+
+#include "diagnostics.hpp"
+
+#include <exception>
+#include <istream>
+#include <string>
+#include <toml.hpp>
+#include <tsl/ordered_map.h>
+#include <vector>
+
+namespace cmkr {
+namespace parser {
+
+// The only toml11 value type in cmkr, tables keep the order of the file
+using TomlBasicValue = toml::basic_value<toml::discard_comments, tsl::ordered_map, std::vector>;
+
+// Parses a whole cmake.toml, throws toml::syntax_error
+TomlBasicValue parse_toml(std::istream &is, const std::string &filename);
+
+// Fills in the location of a toml11 syntax or type error, returns false if there is none
+bool toml_error_location(const std::exception &e, diag::Diagnostic &diagnostic);
+
+} // namespace parser
+} // namespace cmkr
+
+// The toml11 parser is by far the most expensive template to compile, it is only
+// instantiated in toml_parser.cpp (which is kept out of unity batches).
+extern template cmkr::parser::TomlBasicValue toml::parse<toml::discard_comments, tsl::ordered_map, std::vector>(std::istream &, std::string);
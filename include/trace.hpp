@@ -0,0 +1,74 @@
+#pragma once
+
+#include "fs.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cmkr {
+namespace trace {
+
+struct Event {
+    std::string name;
+    // Static string, one of the phases (parse, glob, check, emit, write, cache) or directory/target
+    const char *category = "";
+    // Directory the event belongs to, relative to the root project
+    std::string directory;
+    // Microseconds since the recorder was created
+    long long start = 0;
+    long long duration = 0;
+    unsigned int thread = 0;
+};
+
+// Collects timed events from all the generator threads. Thread-safe.
+class Recorder {
+    mutable std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<Event> m_events;
+    std::map<std::thread::id, unsigned int> m_threads;
+
+  public:
+    Recorder();
+
+    long long now() const;
+
+    void record(Event event);
+
+    struct Total {
+        std::string category;
+        // Microseconds, summed over all the threads
+        long long duration = 0;
+        size_t count = 0;
+    };
+
+    // Time spent per phase, in order of first appearance. Nested phases (and work the thread
+    // picked up while waiting for a task group) are not counted twice: each phase only gets
+    // its own time, plus the time of the targets it contains.
+    std::vector<Total> totals() const;
+
+    // Writes the events in the Chrome trace event format (chrome://tracing, Perfetto)
+    void write_chrome(const fs::path &file) const;
+
+    // Prints the time spent per phase and the slowest directories and targets
+    void print_summary(size_t count) const;
+};
+
+// Records the time until the end of the scope, does nothing without a recorder
+class Scope {
+    Recorder *m_recorder;
+    Event m_event;
+
+  public:
+    Scope(Recorder *recorder, const char *category, const std::string &name, const std::string &directory = std::string());
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+};
+
+} // namespace trace
+} // namespace cmkr
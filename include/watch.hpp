@@ -0,0 +1,44 @@
+#pragma once
+
+#include "cmake_generator.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cmkr {
+namespace watch {
+
+struct Generation {
+    // The generation when the watch started, every later one was caused by a change
+    bool initial = false;
+    bool success = false;
+    // Only set if the generation failed, the previous files are kept and watching continues
+    std::string error;
+    // Files whose contents changed (and were written)
+    std::vector<std::string> written;
+    double milliseconds = 0;
+    // Directories watched after this generation
+    size_t directories = 0;
+};
+
+struct Options {
+    // Generator settings (jobs, stats), the watch sets its session and outputs
+    gen::Options generator;
+    // Called after every generation, including the failed ones
+    std::function<void(const Generation &)> report;
+    // Checked between events, run returns once it is set (nullptr = until the process is stopped)
+    const std::atomic<bool> *stop = nullptr;
+};
+
+// Generates the project and keeps regenerating it when a cmake.toml, a directory a glob
+// listed or a generated file changes. The parsed cmake.toml files and the directory
+// listings stay in memory, only the directories whose inputs changed are generated again.
+// Only supported on Linux (inotify). The cmake.toml documents are process-wide, so nothing
+// else may generate in the same process while watching.
+void run(const std::string &path, const Options &options);
+
+} // namespace watch
+} // namespace cmkr
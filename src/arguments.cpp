@@ -3,13 +3,101 @@
 #include "cmake_generator.hpp"
 #include "help.hpp"
 #include "fs.hpp"
+#include "library.hpp"
+#include "watch.hpp"
 
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace cmkr {
 namespace args {
+
+static gen::Options parse_gen_options(const std::vector<std::string> &args, size_t first) {
+    gen::Options options;
+    for (size_t i = first; i < args.size(); i++) {
+        const auto &arg = args[i];
+
+        // Supports both '--name value' and '--name=value'
+        std::string value;
+        auto match = [&](const char *name) {
+            auto length = strlen(name);
+            if (arg == name) {
+                if (i + 1 >= args.size()) {
+                    throw std::runtime_error("Missing value for " + arg);
+                }
+                value = args[++i];
+                return true;
+            }
+            if (arg.compare(0, length, name) == 0 && arg.size() > length && arg[length] == '=') {
+                value = arg.substr(length + 1);
+                return true;
+            }
+            return false;
+        };
+
+        auto parse_jobs = [](const std::string &jobs) {
+            if (jobs.empty() || jobs.find_first_not_of("0123456789") != std::string::npos) {
+                throw std::runtime_error("Invalid job count '" + jobs + "'");
+            }
+            return static_cast<unsigned int>(std::stoul(jobs));
+        };
+
+        if (match("-j") || match("--jobs")) {
+            options.jobs = parse_jobs(value);
+        } else if (arg.compare(0, 2, "-j") == 0) {
+            options.jobs = parse_jobs(arg.substr(2));
+        } else if (match("--cache-dir")) {
+            options.cache_dir = value;
+        } else if (match("--trace")) {
+            options.trace = value;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else {
+            throw std::runtime_error("Unknown argument '" + arg + "'");
+        }
+    }
+    return options;
+}
+
+// Generates the current directory, prints the warnings and throws the error (if any)
+static void generate(const gen::Options &generator) {
+    lib::Options options;
+    options.write = true;
+    options.generator = generator;
+    auto result = lib::generate(fs::current_path().string(), options);
+    for (const auto &diagnostic : result.diagnostics) {
+        if (diagnostic.severity == diag::severity_error) {
+            throw std::runtime_error(diagnostic.text);
+        }
+        puts(diagnostic.text.c_str());
+    }
+}
+
+// Regenerates the current directory on every change until the process is stopped
+static void watch_project(const gen::Options &generator) {
+    auto root = fs::current_path();
+    watch::Options options;
+    options.generator = generator;
+    options.report = [&root](const watch::Generation &generation) {
+        if (!generation.success) {
+            // Same format as main()
+            auto format = generation.error.find('\n') != std::string::npos ? "%s\n" : "[cmkr] error: %s\n";
+            fprintf(stderr, format, generation.error.c_str());
+        }
+        for (const auto &file : generation.written) {
+            printf("[cmkr] Generated %s\n", fs::path(file).lexically_relative(root).generic_string().c_str());
+        }
+        if (generation.initial || !generation.written.empty()) {
+            printf("[cmkr] Generation took %.1f ms, watching %zu directories\n", generation.milliseconds, generation.directories);
+        }
+        fflush(stdout);
+    };
+    watch::run(root.string(), options);
+}
+
 const char *handle_args(int argc, char **argv) {
     std::vector<std::string> args;
     for (int i = 0; i < argc; ++i)
@@ -19,8 +107,11 @@ const char *handle_args(int argc, char **argv) {
         throw std::runtime_error(cmkr::help::message());
     std::string main_arg = args[1];
     if (main_arg == "gen") {
-        cmkr::gen::generate_cmake(fs::current_path().string().c_str());
+        generate(parse_gen_options(args, 2));
         return "CMake generation successful!";
+    } else if (main_arg == "watch") {
+        watch_project(parse_gen_options(args, 2));
+        return "Stopped watching";
     } else if (main_arg == "help") {
         return cmkr::help::message();
     } else if (main_arg == "version") {
@@ -30,7 +121,7 @@ const char *handle_args(int argc, char **argv) {
         if (args.size() > 2)
             type = args[2];
         cmkr::gen::generate_project(type.c_str());
-        cmkr::gen::generate_cmake(fs::current_path().string().c_str());
+        generate(gen::Options());
         return "Directory initialized!";
     } else if (main_arg == "build") {
         auto ret = build::run(argc, argv);
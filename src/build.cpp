@@ -3,24 +3,25 @@
 #include "project_parser.hpp"
 
 #include "fs.hpp"
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
 
 namespace cmkr {
 namespace build {
 
-int run(int argc, char **argv) {
-    parser::Project project(nullptr, ".", true);
-    if (argc > 2) {
-        for (int i = 2; i < argc; ++i) {
-            project.build_args.emplace_back(argv[i]);
-        }
-    }
+static std::string configure_command(const parser::Project &project, const std::string &definitions) {
     std::stringstream ss;
-
-    gen::generate_cmake(fs::current_path().string().c_str());
-
-    ss << "cmake -DCMKR_BUILD_SKIP_GENERATION=ON -B" << project.build_dir << " ";
+    ss << "cmake -DCMKR_BUILD_SKIP_GENERATION=ON " << definitions << "-B" << project.build_dir << " ";
 
     if (!project.generator.empty()) {
         ss << "-G \"" << project.generator << "\" ";
@@ -33,14 +34,232 @@ int run(int argc, char **argv) {
             ss << "-D" << arg << " ";
         }
     }
-    ss << "&& cmake --build " << project.build_dir << " --parallel";
-    if (argc > 2) {
+    return ss.str();
+}
+
+// The config goes before the [cmake].build-args, which can end in "-- <native build tool arguments>"
+static std::string build_command(const parser::Project &project, bool build_args, const std::string &config = std::string()) {
+    std::stringstream ss;
+    ss << "cmake --build " << project.build_dir << " --parallel";
+    if (!config.empty()) {
+        ss << " --config " << config;
+    }
+    if (build_args) {
         for (const auto &arg : project.build_args) {
             ss << " " << arg;
         }
     }
+    return ss.str();
+}
+
+// The [cmake].compiler-launcher found by the configuration, empty if there is none
+static std::string compiler_launcher(const parser::Project &project) {
+    std::ifstream cache((fs::path(project.build_dir) / "CMakeCache.txt").string());
+    std::string line;
+    const std::string prefix = "CMKR_COMPILER_LAUNCHER:INTERNAL=";
+    while (std::getline(cache, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            return line.substr(prefix.size());
+        }
+    }
+    return std::string();
+}
+
+struct CacheStats {
+    bool valid = false;
+    long long hits = 0;
+    long long misses = 0;
+};
+
+// The statistics are totals of the cache (shared by every build), only the difference is reported
+static CacheStats cache_stats(const std::string &launcher) {
+    CacheStats stats;
+    if (launcher.empty()) {
+        return stats;
+    }
+    auto sccache = fs::path(launcher).stem().string() == "sccache";
+    // ccache prints machine-readable statistics (older versions fail), sccache only has the table
+    auto command = "\"" + launcher + "\"" + (sccache ? " --show-stats" : " --print-stats");
+    auto pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return stats;
+    }
+    std::string output;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, size);
+    }
+    if (pclose(pipe) != 0) {
+        return stats;
+    }
+
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        std::string key;
+        long long value = 0;
+        if (sccache) {
+            // Cache hits                           12
+            std::string first, second;
+            if (!(words >> first >> second >> value) || first != "Cache") {
+                continue;
+            }
+            key = second;
+        } else {
+            // direct_cache_hit<TAB>12
+            if (!(words >> key >> value)) {
+                continue;
+            }
+        }
+        if (key == "hits" || key == "direct_cache_hit" || key == "preprocessed_cache_hit") {
+            stats.hits += value;
+            stats.valid = true;
+        } else if (key == "misses" || key == "cache_miss") {
+            stats.misses += value;
+            stats.valid = true;
+        }
+    }
+    return stats;
+}
+
+// The launcher is only known once the project is configured, so the build is a separate command
+static int configure_and_build(const parser::Project &project, const std::string &configure, const std::string &build) {
+    auto ret = ::system(configure.c_str());
+    if (ret != 0) {
+        return ret;
+    }
+    auto launcher = compiler_launcher(project);
+    auto before = cache_stats(launcher);
+    ret = ::system(build.c_str());
+    auto after = cache_stats(launcher);
+    if (before.valid && after.valid) {
+        auto hits = after.hits - before.hits;
+        auto misses = after.misses - before.misses;
+        auto name = fs::path(launcher).stem().string();
+        if (hits + misses > 0) {
+            printf("[cmkr] %s: %lld hits, %lld misses (%.0f%% hit rate)\n", name.c_str(), hits, misses, 100.0 * hits / (hits + misses));
+        } else {
+            printf("[cmkr] %s: nothing was compiled\n", name.c_str());
+        }
+        fflush(stdout);
+    }
+    return ret;
+}
+
+// The llvm-profdata next to the compiler in the CMake cache, with the same version suffix (clang++-15)
+static std::string llvm_profdata(const parser::Project &project) {
+    auto environment = getenv("LLVM_PROFDATA");
+    if (environment != nullptr && *environment != '\0') {
+        return environment;
+    }
+    std::ifstream cache((fs::path(project.build_dir) / "CMakeCache.txt").string());
+    std::string line;
+    while (std::getline(cache, line)) {
+        const std::string prefixes[] = {"CMAKE_CXX_COMPILER:", "CMAKE_C_COMPILER:"};
+        for (const auto &prefix : prefixes) {
+            if (line.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            fs::path compiler = line.substr(line.find('=') + 1);
+            auto name = compiler.filename().string();
+            auto clang = name.find("clang");
+            if (clang == std::string::npos) {
+                continue;
+            }
+            auto suffix = name.substr(clang + 5);
+            if (suffix.compare(0, 2, "++") == 0) {
+                suffix = suffix.substr(2);
+            }
+            for (const auto &candidate : {"llvm-profdata" + suffix, std::string("llvm-profdata")}) {
+                auto path = compiler.parent_path() / candidate;
+                if (fs::exists(path)) {
+                    return path.string();
+                }
+            }
+        }
+    }
+    return "llvm-profdata";
+}
+
+// Instrument, train, merge and rebuild with the profiles
+static int run_pgo(parser::Project project, bool build_args) {
+    // The profiles are only worth it for optimized builds
+    if (project.config.empty()) {
+        project.config = "Release";
+    }
+    auto profiles = fs::absolute(fs::path(project.build_dir) / "cmkr-pgo");
+    auto definitions = "-DCMKR_PGO_DIRECTORY=\"" + profiles.generic_string() + "\" ";
+    auto build = build_command(project, build_args, project.config);
+
+    puts("[cmkr] Profile-guided optimization: building the instrumented targets");
+    fflush(stdout);
+    auto ret = configure_and_build(project, configure_command(project, "-DCMKR_PGO=generate " + definitions), build);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // The profiles of a previous run would be merged with the new ones
+    fs::remove_all(profiles);
+    fs::create_directories(profiles);
+
+    puts("[cmkr] Profile-guided optimization: running the [[pgo-training]]");
+    fflush(stdout);
+    std::stringstream train;
+    train << "cd \"" << project.build_dir << "\" && ctest --no-tests=error --output-on-failure -L cmkr-pgo-training -C " << project.config;
+    ret = ::system(train.str().c_str());
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Clang writes raw profiles that have to be merged, GCC uses the .gcda files directly
+    std::vector<std::string> raw_profiles;
+    for (const auto &entry : fs::directory_iterator(profiles)) {
+        if (entry.path().extension() == ".profraw") {
+            raw_profiles.push_back(entry.path().string());
+        }
+    }
+    if (!raw_profiles.empty()) {
+        puts("[cmkr] Profile-guided optimization: merging the profiles");
+        fflush(stdout);
+        std::stringstream merge;
+        merge << "\"" << llvm_profdata(project) << "\" merge \"-output=" << (profiles / "default.profdata").string() << "\"";
+        for (const auto &profile : raw_profiles) {
+            merge << " \"" << profile << "\"";
+        }
+        ret = ::system(merge.str().c_str());
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    puts("[cmkr] Profile-guided optimization: building the optimized targets");
+    fflush(stdout);
+    return configure_and_build(project, configure_command(project, "-DCMKR_PGO=use " + definitions), build);
+}
+
+int run(int argc, char **argv) {
+    parser::Project project(nullptr, ".", true);
+    auto pgo = false;
+    if (argc > 2) {
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--pgo") {
+                pgo = true;
+            } else {
+                project.build_args.emplace_back(argv[i]);
+            }
+        }
+    }
 
-    return ::system(ss.str().c_str());
+    gen::Options options;
+    options.cache_dir = (fs::path(project.build_dir) / "cmkr-cache").string();
+    gen::generate_cmake(fs::current_path().string().c_str(), options);
+
+    if (pgo) {
+        return run_pgo(project, argc > 2);
+    }
+    return configure_and_build(project, configure_command(project, ""), build_command(project, argc > 2));
 }
 
 int clean() {
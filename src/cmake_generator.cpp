@@ -2,13 +2,28 @@
 #include "literals.hpp"
 #include <resources/cmkr.hpp>
 
+#include "diagnostics.hpp"
+#include "directory_cache.hpp"
+#include "emitter.hpp"
+#include "files.hpp"
 #include "fs.hpp"
+#include "glob.hpp"
+#include "help.hpp"
+#include "manifest.hpp"
 #include "project_parser.hpp"
+#include "sha256.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cctype>
 #include <cstdio>
+#include <ctime>
+#include <exception>
 #include <memory>
-#include <sstream>
 #include <stdexcept>
-#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unordered_set>
 
 namespace cmkr {
 namespace gen {
@@ -58,6 +73,102 @@ static std::string quoted(const std::string &str) {
     return "\"" + str + "\"";
 }
 
+// The unity settings of the target override the ones of the template, the exclusions are combined
+static parser::Unity merge_unity(const parser::Template *tmplate, const parser::Target &target) {
+    if (tmplate == nullptr) {
+        return target.unity;
+    }
+    auto unity = tmplate->outline.unity;
+    const auto &own = target.unity;
+    if (own.specified) {
+        unity.specified = true;
+        unity.enable = own.enable;
+    }
+    if (own.batch_size >= 0) {
+        unity.batch_size = own.batch_size;
+    }
+    if (own.mode != parser::unity_last) {
+        unity.mode = own.mode;
+    }
+    unity.exclude.insert(unity.exclude.end(), own.exclude.begin(), own.exclude.end());
+    return unity;
+}
+
+// The bolt settings of the target replace the ones of the template
+static const parser::Bolt &merge_bolt(const parser::Template *tmplate, const parser::Target &target) {
+    if (tmplate == nullptr || target.bolt.specified) {
+        return target.bolt;
+    }
+    return tmplate->outline.bolt;
+}
+
+// The lto of the target overrides the one of the template, the [project].lto is the default
+static parser::Condition<std::string> merge_lto(const parser::Project &project, const parser::Template *tmplate, const parser::Target &target) {
+    parser::Condition<std::string> lto;
+    if (project.find_lto() != parser::lto_last) {
+        lto[""] = parser::ltoModeNames[project.find_lto()];
+    }
+    if (tmplate != nullptr) {
+        for (const auto &itr : tmplate->outline.lto) {
+            lto[itr.first] = itr.second;
+        }
+    }
+    for (const auto &itr : target.lto) {
+        lto[itr.first] = itr.second;
+    }
+    return lto;
+}
+
+// The pgo of the target overrides the one of the template, only the enabled conditions are kept
+static parser::Condition<std::string> merge_pgo(const parser::Template *tmplate, const parser::Target &target) {
+    parser::Condition<bool> pgo;
+    if (tmplate != nullptr) {
+        pgo = tmplate->outline.pgo;
+    }
+    for (const auto &itr : target.pgo) {
+        pgo[itr.first] = itr.second;
+    }
+    // handle_condition skips the empty values
+    parser::Condition<std::string> enabled;
+    for (const auto &itr : pgo) {
+        if (itr.second) {
+            enabled[itr.first] = "ON";
+        }
+    }
+    return enabled;
+}
+
+// File name of an executable on Linux, where BOLT runs
+static std::string output_name(const parser::Template *tmplate, const parser::Target &target) {
+    for (const auto &properties : {&target.properties, tmplate == nullptr ? nullptr : &tmplate->outline.properties}) {
+        if (properties == nullptr) {
+            continue;
+        }
+        auto itr = properties->find("");
+        if (itr != properties->end()) {
+            auto name = itr->second.find("OUTPUT_NAME");
+            if (name != itr->second.end()) {
+                return name->second;
+            }
+        }
+    }
+    return target.name;
+}
+
+// Name of the UNITY_GROUP of the sources in a directory (the group is part of a file name)
+static std::string unity_group(const std::string &source) {
+    auto group = fs::path(source).parent_path().generic_string();
+    if (group.empty() || group == ".") {
+        return "root";
+    }
+    for (auto &ch : group) {
+        if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '-' && ch != '_') {
+            ch = '_';
+        }
+    }
+    return group;
+}
+
 static std::string space_error_check(const std::string &str) {
     auto pos = str.find_last_of(' ');
     if (pos != std::string::npos)
@@ -66,7 +177,7 @@ static std::string space_error_check(const std::string &str) {
         return quoted(str);
 }
 
-static std::vector<fs::path> expand_cmake_path(const fs::path &source_path, const fs::path &toml_dir, bool is_root_project) {
+static void check_source_path(const fs::path &source_path, const fs::path &toml_dir) {
     auto is_subdir = [](fs::path p, const fs::path &root) {
         while (true) {
             if (p == root) {
@@ -83,54 +194,69 @@ static std::vector<fs::path> expand_cmake_path(const fs::path &source_path, cons
     if (!is_subdir(fs::absolute(toml_dir / source_path), toml_dir)) {
         throw std::runtime_error("Path traversal is not allowed: " + source_path.string());
     }
+}
 
-    // Split the path at the first period (since fs::path::stem() and fs::path::extension() split at the last period)
-    std::string stem, extension;
-    auto filename = source_path.filename().string();
-    auto dot_position = filename.find('.');
-    if (dot_position != std::string::npos) {
-        stem = filename.substr(0, dot_position);
-        extension = filename.substr(dot_position);
-    } else {
-        stem = filename;
-    }
+static std::vector<std::string> expand_cmake_paths(pool::ThreadPool &pool, dircache::DirectoryCache &directories,
+                                                   const std::vector<std::string> &sources, const fs::path &toml_dir, bool is_root_project,
+                                                   const std::vector<std::string> &ignore_files, manifest::Directory *record) {
+    // All the patterns are matched in a single pass over the directory tree
+    glob::Matcher matcher;
+    matcher.ignore_files(ignore_files);
+    std::vector<size_t> patterns;
+    for (const auto &src : sources) {
+        // Exclusions apply to all the paths in the list, regardless of their position
+        if (!src.empty() && src[0] == '!') {
+            check_source_path(src.substr(1), toml_dir);
+            matcher.exclude(src.substr(1));
+            patterns.push_back(std::string::npos);
+            continue;
+        }
 
-    if (is_root_project && stem == "**" && !source_path.has_parent_path()) {
-        throw std::runtime_error("Recursive globbing not allowed in project root: " + source_path.string());
-    }
+        check_source_path(src, toml_dir);
+        if (!glob::is_pattern(src)) {
+            patterns.push_back(std::string::npos);
+            continue;
+        }
+        // A file named like a pattern (src/foo[1].cpp, gen/{uuid}.c) is used as-is
+        if (record != nullptr) {
+            record->add_listing(directories, toml_dir, fs::path(src).parent_path());
+        }
+        if (directories.exists(toml_dir / src)) {
+            patterns.push_back(std::string::npos);
+            continue;
+        }
 
-    auto has_extension = [](const fs::path &file_path, const std::string &extension) {
-        auto path = file_path.string();
-        return path.rfind(extension) == path.length() - extension.length();
-    };
+        auto index = matcher.add(src);
+        if (is_root_project && matcher.starts_recursive(index)) {
+            throw std::runtime_error("Recursive globbing not allowed in project root: " + src);
+        }
+        patterns.push_back(index);
+    }
 
-    std::vector<fs::path> paths;
-    if (stem == "*") {
-        for (const auto &f : fs::directory_iterator(toml_dir / source_path.parent_path(), fs::directory_options::follow_directory_symlink)) {
-            if (!f.is_directory() && has_extension(f.path(), extension)) {
-                paths.push_back(fs::relative(f, toml_dir));
-            }
+    glob::Matcher::Result expanded;
+    if (!matcher.empty()) {
+        expanded = matcher.expand(directories, pool, toml_dir);
+    }
+    if (record != nullptr) {
+        for (const auto &directory : expanded.directories) {
+            record->add_listing(directories, toml_dir, directory);
         }
-    } else if (stem == "**") {
-        for (const auto &f :
-             fs::recursive_directory_iterator(toml_dir / source_path.parent_path(), fs::directory_options::follow_directory_symlink)) {
-            if (!f.is_directory() && has_extension(f.path(), extension)) {
-                paths.push_back(fs::relative(f, toml_dir));
-            }
+        for (const auto &file : expanded.ignore_files) {
+            record->add_input(toml_dir, file);
         }
-    } else {
-        paths.push_back(source_path);
     }
 
-    return paths;
-}
-
-static std::vector<std::string> expand_cmake_paths(const std::vector<std::string> &sources, const fs::path &toml_dir, bool is_root_project) {
     std::vector<std::string> paths;
-    for (const auto &src : sources) {
-        auto expanded = expand_cmake_path(src, toml_dir, is_root_project);
-        for (const auto &f : expanded) {
-            paths.push_back(f.string());
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto &src = sources[i];
+        if (patterns[i] == std::string::npos) {
+            if (src[0] != '!' && !matcher.excluded(src)) {
+                paths.push_back(src);
+            }
+            continue;
+        }
+        for (const auto &match : expanded.matches[patterns[i]]) {
+            paths.push_back(match.string());
         }
     }
 
@@ -139,38 +265,21 @@ static std::vector<std::string> expand_cmake_paths(const std::vector<std::string
         std::replace(path.begin(), path.end(), '\\', '/');
     }
 
+    // Remove duplicates (a file can match multiple patterns) before sorting
+    std::unordered_set<std::string> unique_paths;
+    unique_paths.reserve(paths.size());
+    paths.erase(std::remove_if(paths.begin(), paths.end(),
+                               [&unique_paths](const std::string &path) {
+                                   return !unique_paths.insert(path).second;
+                               }),
+                paths.end());
+
     // Sort paths alphabetically for consistent cross-OS generation
     std::sort(paths.begin(), paths.end());
 
-    // TODO: remove duplicates
-
     return paths;
 }
 
-static void create_file(const fs::path &path, const std::string &contents) {
-    if (!path.parent_path().empty()) {
-        fs::create_directories(path.parent_path());
-    }
-    std::ofstream ofs(path, std::ios::binary);
-    if (!ofs) {
-        throw std::runtime_error("Failed to create " + path.string());
-    }
-    ofs << contents;
-}
-
-static std::string read_file(const fs::path &path) {
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) {
-        throw std::runtime_error("Failed to read " + path.string());
-    }
-    std::string contents;
-    ifs.seekg(0, std::ios::end);
-    contents.resize(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-    ifs.read(&contents[0], contents.size());
-    return contents;
-}
-
 // CMake target name rules: https://cmake.org/cmake/help/latest/policy/CMP0037.html [A-Za-z0-9_.+\-]
 // TOML bare keys: non-empty strings composed only of [A-Za-z0-9_-]
 // We replace all non-TOML bare key characters with _
@@ -201,9 +310,9 @@ static void generate_gitfile(const char *gitfile, const std::vector<std::string>
         return generated;
     };
     if (!fs::exists(gitfile)) {
-        create_file(gitfile, generate("\n"));
+        files::write(gitfile, generate("\n"));
     } else {
-        auto contents = read_file(gitfile);
+        auto contents = files::read(gitfile);
         std::string line;
         auto cr = 0, lf = 0;
         auto flush_line = [&line, &lines]() {
@@ -237,7 +346,7 @@ static void generate_gitfile(const char *gitfile, const std::vector<std::string>
             }
             contents += newline;
             contents += generate(newline);
-            create_file(gitfile, contents);
+            files::write(gitfile, contents);
         }
     }
 }
@@ -273,216 +382,25 @@ void generate_project(const std::string &type) {
         std::error_code ec;
         fs::rename("CMakeLists.txt", "CMakeLists.txt.bak", ec);
         // Create an empty cmake.toml for migration purporses
-        create_file("cmake.toml", format(toml_migration, variables));
+        files::write("cmake.toml", format(toml_migration, variables));
         return;
     }
 
     if (type == "executable") {
-        create_file("cmake.toml", format(toml_executable, variables));
-        create_file("src/" + name + "/main.cpp", format(cpp_executable, variables));
+        files::write("cmake.toml", format(toml_executable, variables));
+        files::write("src/" + name + "/main.cpp", format(cpp_executable, variables));
     } else if (type == "static" || type == "shared" || type == "library") {
-        create_file("cmake.toml", format(toml_library, variables));
-        create_file("src/" + name + "/" + name + ".cpp", format(cpp_library, variables));
-        create_file("include/" + name + "/" + name + ".hpp", format(hpp_library, variables));
+        files::write("cmake.toml", format(toml_library, variables));
+        files::write("src/" + name + "/" + name + ".cpp", format(cpp_library, variables));
+        files::write("include/" + name + "/" + name + ".hpp", format(hpp_library, variables));
     } else if (type == "interface") {
-        create_file("cmake.toml", format(toml_interface, variables));
-        create_file("include/" + name + "/" + name + ".hpp", format(hpp_interface, variables));
+        files::write("cmake.toml", format(toml_interface, variables));
+        files::write("include/" + name + "/" + name + ".hpp", format(hpp_interface, variables));
     } else {
         throw std::runtime_error("Unknown project type " + type + "! Supported types are: executable, library, shared, static, interface");
     }
 }
 
-struct CommandEndl {
-    std::stringstream &ss;
-    explicit CommandEndl(std::stringstream &ss) : ss(ss) {
-    }
-    void endl() {
-        ss << '\n';
-    }
-};
-
-struct RawArg {
-    RawArg() = default;
-    explicit RawArg(std::string arg) : arg(std::move(arg)) {
-    }
-
-    std::string arg;
-
-    bool empty() const {
-        return arg.empty();
-    }
-};
-
-// Credit: JustMagic
-struct Command {
-    std::stringstream &ss;
-    int depth = 0;
-    std::string command;
-    bool first_arg = true;
-    bool had_newline = false;
-    bool generated = false;
-    std::string post_comment;
-
-    Command(std::stringstream &ss, int depth, std::string command, std::string post_comment)
-        : ss(ss), depth(depth), command(std::move(command)), post_comment(std::move(post_comment)) {
-    }
-
-    ~Command() noexcept(false) {
-        if (!generated) {
-            throw std::runtime_error("Incorrect usage of cmd(), you probably forgot ()");
-        }
-    }
-
-    static std::string quote(const std::string &str) {
-        // Quote an empty string
-        if (str.empty()) {
-            return "\"\"";
-        }
-        // Don't quote arguments that don't need quoting
-        // https://cmake.org/cmake/help/latest/manual/cmake-language.7.html#unquoted-argument
-        // NOTE: Normally '/' does not require quoting according to the documentation but this has been the case here
-        //       previously, so for backwards compatibility its still here.
-        if (str.find_first_of("()#\"\\'> |/;") == std::string::npos)
-            return str;
-        std::string result;
-        result += "\"";
-        for (char ch : str) {
-            switch (ch) {
-            case '\\':
-            case '\"':
-                result += '\\';
-            default:
-                result += ch;
-                break;
-            }
-        }
-        result += "\"";
-        return result;
-    }
-
-    static std::string indent(int n) {
-        std::string result;
-        for (int i = 0; i < n; i++) {
-            result += '\t';
-        }
-        return result;
-    }
-
-    template <class T>
-    bool print_arg(const std::vector<T> &vec) {
-        if (vec.empty()) {
-            return true;
-        }
-
-        had_newline = true;
-        for (const auto &value : vec) {
-            print_arg(value);
-        }
-
-        return true;
-    }
-
-    template <class Key, class Value>
-    bool print_arg(const tsl::ordered_map<Key, Value> &map) {
-        if (map.empty()) {
-            return true;
-        }
-
-        for (const auto &itr : map) {
-            print_arg(itr);
-        }
-
-        return true;
-    }
-
-    template <class K>
-    bool print_arg(const std::pair<K, std::vector<std::string>> &kv) {
-        if (kv.second.empty()) {
-            return true;
-        }
-
-        had_newline = true;
-        print_arg(kv.first);
-        depth++;
-        for (const auto &s : kv.second) {
-            print_arg(s);
-        }
-        depth--;
-
-        return true;
-    }
-
-    template <class K, class V>
-    bool print_arg(const std::pair<K, V> &kv) {
-        if (kv.second.empty()) {
-            return true;
-        }
-
-        had_newline = true;
-        print_arg(kv.first);
-        depth++;
-        print_arg(kv.second);
-        depth--;
-
-        return true;
-    }
-
-    bool print_arg(const RawArg &arg) {
-        if (arg.empty()) {
-            return true;
-        }
-
-        if (had_newline) {
-            first_arg = false;
-            ss << '\n' << indent(depth + 1);
-        } else if (first_arg) {
-            first_arg = false;
-        } else {
-            ss << ' ';
-        }
-
-        ss << arg.arg;
-        return true;
-    }
-
-    template <class T>
-    bool print_arg(const T &value) {
-        std::stringstream tmp;
-        tmp << value;
-        auto str = tmp.str();
-        if (str.empty()) {
-            return true;
-        }
-
-        if (had_newline) {
-            first_arg = false;
-            ss << '\n' << indent(depth + 1);
-        } else if (first_arg) {
-            first_arg = false;
-        } else {
-            ss << ' ';
-        }
-
-        ss << quote(str);
-        return true;
-    }
-
-    template <class... Ts>
-    CommandEndl operator()(Ts &&...values) {
-        generated = true;
-        ss << indent(depth) << command << '(';
-        (void)std::initializer_list<bool>{print_arg(values)...};
-        if (had_newline)
-            ss << '\n' << indent(depth);
-        ss << ")";
-        if (!post_comment.empty()) {
-            ss << " # " << post_comment;
-        }
-        ss << "\n";
-        return CommandEndl(ss);
-    }
-};
-
 static std::string tolf(const std::string &str) {
     std::string result;
     for (char ch : str) {
@@ -494,15 +412,32 @@ static std::string tolf(const std::string &str) {
 }
 
 struct Generator {
-    Generator(const parser::Project &project, fs::path path) : project(project), path(std::move(path)) {
+    Generator(const parser::Project &project, fs::path path, pool::ThreadPool &pool, dircache::DirectoryCache &directories,
+              manifest::Directory *record, trace::Recorder *trace, std::string key)
+        : project(project), path(std::move(path)), pool(pool), directories(directories), record(record), trace(trace), key(std::move(key)) {
+        ss.reserve(64 * 1024);
     }
     Generator(const Generator &) = delete;
 
     const parser::Project &project;
     fs::path path;
-    std::stringstream ss;
+    pool::ThreadPool &pool;
+    dircache::DirectoryCache &directories;
+    manifest::Directory *record;
+    // Only set when tracing is enabled
+    trace::Recorder *trace;
+    // Directory relative to the root project, used to label trace events
+    std::string key;
+    Buffer ss;
     int indent = 0;
 
+    // Record the directory containing a file, so the manifest detects when it is (re)moved
+    void record_parent(const fs::path &file) {
+        if (record != nullptr) {
+            record->add_listing(directories, path, file.parent_path());
+        }
+    }
+
     Command cmd(const std::string &command, const std::string &post_comment = "") {
         if (command.empty())
             throw std::invalid_argument("command cannot be empty");
@@ -518,7 +453,8 @@ struct Generator {
     }
 
     CommandEndl comment(const std::string &comment) {
-        ss << Command::indent(indent) << "# " << comment << '\n';
+        ss.indent(indent);
+        ss << "# " << comment << '\n';
         return CommandEndl(ss);
     }
 
@@ -529,7 +465,8 @@ struct Generator {
     void inject_includes(const std::vector<std::string> &includes) {
         if (!includes.empty()) {
             for (const auto &file : includes) {
-                if (!fs::exists(path / file)) {
+                record_parent(file);
+                if (!directories.exists(path / file)) {
                     throw std::runtime_error("Include not found: " + file);
                 }
                 cmd("include")(file);
@@ -548,7 +485,7 @@ struct Generator {
             bool did_indent = false;
             for (char ch : cmake_lf) {
                 if (!did_indent) {
-                    ss << Command::indent(indent);
+                    ss.indent(indent);
                     did_indent = true;
                 } else if (ch == '\n') {
                     did_indent = false;
@@ -595,15 +532,15 @@ struct Generator {
         if (condition.empty()) {
             return false;
         }
-        auto found = project.conditions.find(condition);
-        if (found == project.conditions.end()) {
+        auto found = project.find_condition(condition);
+        if (found == nullptr) {
             if (cmkr::parser::Project::is_condition_name(condition)) {
                 // NOTE: this should have been caught by the parser already
                 throw std::runtime_error("Condition '" + condition + "' is not defined");
             }
             cmd("if", "NOTE: unnamed condition")(RawArg(cmake_condition(condition)));
         } else {
-            cmd("if", condition)(RawArg(cmake_condition(found->second)));
+            cmd("if", condition)(RawArg(cmake_condition(*found)));
         }
         return true;
     }
@@ -624,15 +561,15 @@ struct Generator {
                     if (temp.empty()) {
                         throw std::runtime_error("Empty replacement in condition '" + condition + "'");
                     }
-                    auto found = project.conditions.find(temp);
-                    if (found == project.conditions.end()) {
+                    auto found = project.find_condition(temp);
+                    if (found == nullptr) {
                         throw std::runtime_error("Unknown condition '" + temp + "' in replacement");
                     }
-                    auto has_space = found->second.find(' ') != std::string::npos;
+                    auto has_space = found->find(' ') != std::string::npos;
                     if (has_space) {
                         result += '(';
                     }
-                    result += found->second;
+                    result += *found;
                     if (has_space) {
                         result += ')';
                     }
@@ -721,15 +658,52 @@ static std::string vcpkg_escape_identifier(const std::string &name) {
     return escaped;
 }
 
-void generate_cmake(const char *path, const parser::Project *parent_project) {
-    if (!fs::exists(fs::path(path) / "cmake.toml")) {
-        throw std::runtime_error("No cmake.toml found!");
+// Where the generated files of a directory go
+struct Output {
+    bool write = true;
+    // The changed files, written once the generation is known to have reached the directory
+    std::vector<std::pair<fs::path, std::string>> *pending = nullptr;
+    // Only set when the generated files are reported
+    std::vector<OutputFile> *files = nullptr;
+
+    void update(const fs::path &file, const std::string &contents) {
+        auto changed = !files::equals(file, contents);
+        if (changed && write) {
+            pending->emplace_back(file, contents);
+        }
+        if (files != nullptr) {
+            OutputFile output_file;
+            output_file.path = file.string();
+            output_file.contents = contents;
+            output_file.changed = changed;
+            files->push_back(std::move(output_file));
+        }
     }
+};
 
+static void generate_cmakelists(const parser::Project &project, const std::string &path, pool::ThreadPool &pool,
+                                dircache::DirectoryCache &directories, manifest::Directory *record, trace::Recorder *trace,
+                                const std::string &key, Output &output) {
     // Root project doesn't have a parent
-    auto is_root_project = parent_project == nullptr;
-
-    parser::Project project(parent_project, path, false);
+    auto is_root_project = project.parent == nullptr;
+
+    Generator gen(project, path, pool, directories, record, trace, key);
+    std::unique_ptr<trace::Scope> emit_scope(new trace::Scope(trace, "emit", "emit", key));
+
+    // Relative link-libraries and test directories depend on the files in the project directory
+    gen.record_parent("cmake.toml");
+    for (const auto &target : project.targets) {
+        for (const auto *libraries : {&target.link_libraries, &target.private_link_libraries}) {
+            for (const auto &itr : *libraries) {
+                for (const auto &library : itr.second) {
+                    const std::string prefix = "${CMAKE_CURRENT_SOURCE_DIR}/";
+                    if (library.compare(0, prefix.size(), prefix) == 0) {
+                        gen.record_parent(library.substr(prefix.size()));
+                    }
+                }
+            }
+        }
+    }
 
     tsl::ordered_set<std::string> flat_project_languages;
     for (const auto &itr : project.project_languages) {
@@ -747,7 +721,7 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
         auto itr = known_languages.find(language);
         if (itr == known_languages.end()) {
             if (project.project_allow_unknown_languages) {
-                printf("[warning] Unknown language '%s' specified\n", language.c_str());
+                diag::warning(diag::Diagnostic(diag::severity_warning, "[warning] Unknown language '" + language + "' specified"));
             } else {
                 throw std::runtime_error("Unknown language '" + language + "' specified");
             }
@@ -766,8 +740,6 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
         return false;
     };
 
-    Generator gen(project, path);
-
     // Helper lambdas for more convenient CMake generation
     auto &ss = gen.ss;
     auto cmd = [&gen](const std::string &command) {
@@ -842,8 +814,11 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
         // clang-format on
 
         fs::path cmkr_include(project.cmkr_include);
-        if (!project.cmkr_include.empty() && !fs::exists(cmkr_include) && cmkr_include.is_relative()) {
-            create_file(cmkr_include, resources::cmkr);
+        if (!project.cmkr_include.empty() && cmkr_include.is_relative() && !fs::exists(fs::path(path) / cmkr_include)) {
+            output.update(fs::path(path) / cmkr_include, resources::cmkr);
+        }
+        if (record != nullptr && !project.cmkr_include.empty() && cmkr_include.is_relative()) {
+            record->add_output(path, cmkr_include);
         }
     } else {
         comment("Create a configure-time dependency on cmake.toml to improve IDE support");
@@ -920,13 +895,14 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
 
     if (project.vcpkg.enabled()) {
         comment("vcpkg settings");
-        auto emit_overlay = [&cmd](const std::string &name, const std::vector<std::string> &overlay) {
+        auto emit_overlay = [&gen, &cmd](const std::string &name, const std::vector<std::string> &overlay) {
             if (!overlay.empty()) {
                 std::vector<std::string> set_args;
                 for (const auto &directory : overlay) {
                     if (!fs::path(directory).is_relative()) {
                         throw std::runtime_error("[vcpkg] overlay is not a relative path: " + directory);
                     }
+                    gen.record_parent(directory);
                     if (!fs::is_directory(directory)) {
                         throw std::runtime_error("[vcpkg] overlay is not a directory: " + directory);
                     }
@@ -943,12 +919,12 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
     gen.conditional_cmake(project.cmake_before);
 
     if (!project.project_name.empty()) {
-        auto languages = std::make_pair("LANGUAGES", project.project_languages[""]);
+        auto languages = std::make_pair("LANGUAGES", project.project_languages.at(""));
         auto version = std::make_pair("VERSION", project.project_version);
         auto description = std::make_pair("DESCRIPTION", project.project_description);
         cmd("project")(project.project_name, languages, version, description);
 
-        for (const auto &language : project.project_languages[""]) {
+        for (const auto &language : project.project_languages.at("")) {
             if (language == "CSharp") {
                 cmd("include")("CSharpUtilities").endl();
                 break;
@@ -966,6 +942,98 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                 }
             }
         });
+
+        if (is_root_project && project.compiler_launcher != parser::launcher_none) {
+            // The languages CMake supports a <LANG>_COMPILER_LAUNCHER for that ccache and sccache can cache
+            std::vector<std::string> launcher_languages;
+            for (const auto &language : flat_project_languages) {
+                if (language == "C" || language == "CXX" || language == "OBJC" || language == "OBJCXX" || language == "CUDA") {
+                    launcher_languages.push_back(language);
+                }
+            }
+            auto ccache = project.compiler_launcher == parser::launcher_auto || project.compiler_launcher == parser::launcher_ccache;
+            auto sccache = project.compiler_launcher == parser::launcher_auto || project.compiler_launcher == parser::launcher_sccache;
+
+            // clang-format off
+            comment("Compiler launcher (cmkr build reports the cache hits of CMKR_COMPILER_LAUNCHER)");
+            cmd("if")("CMKR_ROOT_PROJECT");
+                if (ccache) {
+                    cmd("find_program")("CMKR_CCACHE", "ccache");
+                }
+                if (sccache) {
+                    cmd("find_program")("CMKR_SCCACHE", "sccache");
+                }
+                cmd("unset")("CMKR_COMPILER_LAUNCHER", "CACHE");
+                cmd("unset")("CMKR_LAUNCHER_COMMAND");
+                if (ccache) {
+                    cmd("if")("CMKR_CCACHE");
+                        cmd("set")("CMKR_COMPILER_LAUNCHER", "${CMKR_CCACHE}", "CACHE", "INTERNAL", RawArg("\"\""));
+                        comment("Paths below base_dir are hashed relative to it, so checkouts in other directories share the cache");
+                        cmd("execute_process")("COMMAND", "${CMKR_CCACHE}", "--version", "OUTPUT_VARIABLE", "CMKR_CCACHE_VERSION", "ERROR_QUIET");
+                        cmd("string")("REGEX", "MATCH", RawArg("\"[0-9]+\\\\.[0-9]+\""), "CMKR_CCACHE_VERSION", RawArg("\"${CMKR_CCACHE_VERSION}\""));
+                        cmd("if")("CMKR_CCACHE_VERSION", "VERSION_LESS", "4.8");
+                            // Configuration on the command line requires ccache 4.8, older versions read the environment
+                            cmd("set")("CMKR_LAUNCHER_COMMAND", "${CMAKE_COMMAND}", "-E", "env", "CCACHE_BASEDIR=${CMAKE_SOURCE_DIR}", "CCACHE_NOHASHDIR=1", "${CMKR_CCACHE}");
+                        cmd("else")();
+                            cmd("set")("CMKR_LAUNCHER_COMMAND", "${CMKR_CCACHE}", "base_dir=${CMAKE_SOURCE_DIR}", "hash_dir=false");
+                        cmd("endif")();
+                    if (sccache) {
+                        cmd("elseif")("CMKR_SCCACHE");
+                            cmd("set")("CMKR_COMPILER_LAUNCHER", "${CMKR_SCCACHE}", "CACHE", "INTERNAL", RawArg("\"\""));
+                            cmd("set")("CMKR_LAUNCHER_COMMAND", "${CMKR_SCCACHE}");
+                        cmd("else")();
+                            cmd("message")("STATUS", "[cmkr] compiler-launcher: ccache and sccache were not found");
+                    } else {
+                        cmd("else")();
+                            cmd("message")("WARNING", "[cmkr] compiler-launcher: ccache was not found");
+                    }
+                    cmd("endif")().endl();
+                } else {
+                    cmd("if")("CMKR_SCCACHE");
+                        cmd("set")("CMKR_COMPILER_LAUNCHER", "${CMKR_SCCACHE}", "CACHE", "INTERNAL", RawArg("\"\""));
+                        cmd("set")("CMKR_LAUNCHER_COMMAND", "${CMKR_SCCACHE}");
+                    cmd("else")();
+                        cmd("message")("WARNING", "[cmkr] compiler-launcher: sccache was not found");
+                    cmd("endif")().endl();
+                }
+
+                cmd("if")("CMKR_LAUNCHER_COMMAND");
+                    comment("A launcher passed with -DCMAKE_<LANG>_COMPILER_LAUNCHER takes precedence");
+                    for (const auto &language : launcher_languages) {
+                        auto variable = "CMAKE_" + language + "_COMPILER_LAUNCHER";
+                        cmd("if")("NOT", "DEFINED", variable);
+                            cmd("set")(variable, RawArg("${CMKR_LAUNCHER_COMMAND}"));
+                        cmd("endif")();
+                    }
+
+                    // The flag is checked with the C++ compiler, or the C compiler in C projects
+                    std::string check_language;
+                    for (const auto &language : launcher_languages) {
+                        if (language == "CXX" || (language == "C" && check_language.empty())) {
+                            check_language = language;
+                        }
+                    }
+                    if (!check_language.empty()) {
+                        auto module = check_language == "CXX" ? "CheckCXXCompilerFlag" : "CheckCCompilerFlag";
+                        auto check = check_language == "CXX" ? "check_cxx_compiler_flag" : "check_c_compiler_flag";
+                        endl();
+                        comment("Relative paths in __FILE__ and the debug information, so the objects do not depend on the checkout directory");
+                        cmd("include")(module);
+                        cmd(check)("-ffile-prefix-map=a=b", "CMKR_FILE_PREFIX_MAP");
+                        cmd("if")("CMKR_FILE_PREFIX_MAP");
+                            std::vector<std::string> options;
+                            for (const auto &language : launcher_languages) {
+                                if (language == "C" || language == "CXX") {
+                                    options.push_back("$<$<COMPILE_LANGUAGE:" + language + ">:-ffile-prefix-map=${CMAKE_SOURCE_DIR}=.>");
+                                }
+                            }
+                            cmd("add_compile_options")(options);
+                        cmd("endif")();
+                    }
+                cmd("endif")();
+            cmd("endif")().endl();
+            // clang-format on
+        }
     }
 
     gen.conditional_includes(project.include_after);
@@ -1022,11 +1090,8 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
         // clang-format on
 
         // Generate vcpkg.json (sorry for the ugly string handling, nlohmann compiles very slowly)
-        std::ofstream ofs("vcpkg.json", std::ios::binary);
-        if (!ofs) {
-            throw std::runtime_error("Failed to create a vcpkg.json manifest file!");
-        }
-        ofs << R"({
+        std::ostringstream json;
+        json << R"({
   "$cmkr": "This file is automatically generated from cmake.toml - DO NOT EDIT",
   "$cmkr-url": "https://github.com/build-cpp/cmkr",
   "$schema": "https://raw.githubusercontent.com/microsoft/vcpkg-tool/main/docs/vcpkg.schema.json",
@@ -1051,28 +1116,28 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                 }
             }
             if (features.empty() && package.default_features) {
-                ofs << "    \"" << package.name << '\"';
+                json << "    \"" << package.name << '\"';
             } else {
-                ofs << "    {\n";
-                ofs << "      \"name\": \"" << package.name << "\",\n";
+                json << "    {\n";
+                json << "      \"name\": \"" << package.name << "\",\n";
                 if (!package.default_features) {
-                    ofs << "      \"default-features\": false,\n";
+                    json << "      \"default-features\": false,\n";
                 }
-                ofs << "      \"features\": [";
+                json << "      \"features\": [";
                 for (size_t j = 0; j < features.size(); j++) {
                     const auto &feature = features[j];
-                    ofs << '\"' << feature << '\"';
+                    json << '\"' << feature << '\"';
                     if (j + 1 < features.size()) {
-                        ofs << ", ";
+                        json << ", ";
                     }
                 }
-                ofs << "]\n";
-                ofs << "    }";
+                json << "]\n";
+                json << "    }";
             }
             if (i + 1 < packages.size()) {
-                ofs << ',';
+                json << ',';
             }
-            ofs << '\n';
+            json << '\n';
         }
 
         auto escape = [](const std::string &str) {
@@ -1086,11 +1151,16 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
             return result;
         };
 
-        ofs << "  ],\n";
-        ofs << "  \"description\": \"" << escape(project.project_description) << "\",\n";
-        ofs << "  \"name\": \"" << escape(vcpkg_escape_identifier(project.project_name)) << "\",\n";
-        ofs << "  \"version-string\": \"none\"\n";
-        ofs << "}\n";
+        json << "  ],\n";
+        json << "  \"description\": \"" << escape(project.project_description) << "\",\n";
+        json << "  \"name\": \"" << escape(vcpkg_escape_identifier(project.project_name)) << "\",\n";
+        json << "  \"version-string\": \"none\"\n";
+        json << "}\n";
+        output.update(fs::path(path) / "vcpkg.json", json.str());
+
+        if (record != nullptr) {
+            record->add_output(path, "vcpkg.json");
+        }
     }
 
     if (!project.packages.empty()) {
@@ -1183,8 +1253,94 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
 
     if (!project.targets.empty()) {
         auto project_root = project.root();
+
+        // The optimization setup is emitted outside of the conditions of the targets,
+        // so every target that enables it sees the same variables
+        auto lto_used = false;
+        auto pgo_used = false;
+        auto bolt_used = false;
+        for (const auto &target : project.targets) {
+            const parser::Template *tmplate = nullptr;
+            auto target_type = target.type;
+            if (target.type == parser::target_template) {
+                tmplate = project.find_template(target.type_name);
+                if (tmplate != nullptr) {
+                    target_type = tmplate->outline.type;
+                }
+            }
+            if (target_type == parser::target_interface || target_type == parser::target_custom) {
+                continue;
+            }
+            for (const auto &itr : merge_lto(project, tmplate, target)) {
+                if (parser::parse_ltoMode(itr.second) != parser::lto_off) {
+                    lto_used = true;
+                }
+            }
+            pgo_used = pgo_used || !merge_pgo(tmplate, target).empty();
+            bolt_used = bolt_used || merge_bolt(tmplate, target).enable;
+        }
+        if (lto_used) {
+            // clang-format off
+            comment("Check for link-time optimization support (cached)");
+            cmd("if")("NOT", "DEFINED", "CMKR_LTO_SUPPORTED");
+                cmd("include")("CheckIPOSupported");
+                cmd("check_ipo_supported")("RESULT", "CMKR_LTO_SUPPORTED", "OUTPUT", "CMKR_LTO_ERROR");
+                cmd("if")("NOT", "CMKR_LTO_SUPPORTED");
+                    cmd("message")("STATUS", "[cmkr] Link-time optimization is not supported: ${CMKR_LTO_ERROR}");
+                cmd("endif")();
+                cmd("set")("CMKR_LTO_SUPPORTED", "${CMKR_LTO_SUPPORTED}", "CACHE", "INTERNAL", RawArg("\"\""));
+            cmd("endif")().endl();
+            // clang-format on
+        }
+        if (pgo_used) {
+            // clang-format off
+            comment("Profile-guided optimization, cmkr build --pgo builds the generate and use phases");
+            cmd("set")("CMKR_PGO", RawArg("\"\""), "CACHE", "STRING", "Profile-guided optimization phase (generate, use)");
+            cmd("set")("CMKR_PGO_DIRECTORY", "${CMAKE_BINARY_DIR}/cmkr-pgo", "CACHE", "PATH", "Profile-guided optimization profiles");
+            cmd("if")("NOT", "DEFINED", "CMKR_PGO_FLAGS");
+                cmd("set")("CMKR_PGO_FLAGS", RawArg("\"\""));
+                cmd("if")("CMKR_PGO", "STREQUAL", "generate", "OR", "CMKR_PGO", "STREQUAL", "use");
+                    cmd("if")(RawArg("(CMAKE_C_COMPILER_ID MATCHES \"Clang\" OR CMAKE_CXX_COMPILER_ID MATCHES \"Clang\") AND NOT MSVC"));
+                        cmd("if")("CMKR_PGO", "STREQUAL", "generate");
+                            cmd("set")("CMKR_PGO_FLAGS", RawArg("\"-fprofile-generate=${CMKR_PGO_DIRECTORY}\""));
+                        cmd("else")();
+                            // cmkr build --pgo merges the raw profiles into default.profdata
+                            cmd("set")("CMKR_PGO_FLAGS", RawArg("\"-fprofile-use=${CMKR_PGO_DIRECTORY}/default.profdata\""), "-Wno-profile-instr-unprofiled");
+                        cmd("endif")();
+                    cmd("elseif")("CMAKE_C_COMPILER_ID", "STREQUAL", "GNU", "OR", "CMAKE_CXX_COMPILER_ID", "STREQUAL", "GNU");
+                        cmd("if")("CMKR_PGO", "STREQUAL", "generate");
+                            cmd("set")("CMKR_PGO_FLAGS", RawArg("\"-fprofile-generate=${CMKR_PGO_DIRECTORY}\""), "-fprofile-update=atomic");
+                        cmd("else")();
+                            cmd("set")("CMKR_PGO_FLAGS", RawArg("\"-fprofile-use=${CMKR_PGO_DIRECTORY}\""), "-fprofile-correction", "-Wno-missing-profile");
+                        cmd("endif")();
+                    cmd("else")();
+                        cmd("message")("WARNING", "[cmkr] Profile-guided optimization is not supported for ${CMAKE_CXX_COMPILER_ID}");
+                    cmd("endif")();
+                cmd("elseif")("CMKR_PGO");
+                    cmd("message")("FATAL_ERROR", "[cmkr] Unknown CMKR_PGO phase '${CMKR_PGO}' (expected generate or use)");
+                cmd("endif")();
+            cmd("endif")().endl();
+            // clang-format on
+        }
+        if (bolt_used) {
+            // clang-format off
+            comment("BOLT post-link optimization (Linux only, skipped for Debug and when llvm-bolt is not found)");
+            cmd("set")("CMKR_BOLT", "OFF");
+            cmd("if")("CMAKE_SYSTEM_NAME", "STREQUAL", "Linux", "AND", "NOT", "CMAKE_CROSSCOMPILING", "AND", "NOT", "CMAKE_BUILD_TYPE", "STREQUAL", "Debug");
+                cmd("find_program")("CMKR_LLVM_BOLT", "llvm-bolt");
+                cmd("find_program")("CMKR_MERGE_FDATA", "merge-fdata");
+                cmd("if")("CMKR_LLVM_BOLT", "AND", "CMKR_MERGE_FDATA");
+                    cmd("set")("CMKR_BOLT", "ON");
+                cmd("else")();
+                    cmd("message")("STATUS", "[cmkr] llvm-bolt not found, executables are not optimized with BOLT");
+                cmd("endif")();
+            cmd("endif")().endl();
+            // clang-format on
+        }
+
         for (size_t i = 0; i < project.targets.size(); i++) {
             const auto &target = project.targets[i];
+            trace::Scope trace_scope(gen.trace, "target", target.name, gen.key);
 
             auto throw_target_error = [&target](const std::string &message) {
                 throw std::runtime_error("[target." + target.name + "] " + message);
@@ -1197,11 +1353,9 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
 
             // Check if this target is using a template.
             if (target.type == parser::target_template) {
-                for (const auto &t : project.templates) {
-                    if (target.type_name == t.outline.name) {
-                        tmplate = &t;
-                        tmplate_cs = std::unique_ptr<ConditionScope>(new ConditionScope(gen, tmplate->outline.condition));
-                    }
+                tmplate = project.find_template(target.type_name);
+                if (tmplate != nullptr) {
+                    tmplate_cs = std::unique_ptr<ConditionScope>(new ConditionScope(gen, tmplate->outline.condition));
                 }
             }
 
@@ -1284,17 +1438,27 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                 cmd("set")(sources_var, RawArg("\"\"")).endl();
             }
 
+            // Reported together after all the conditions are handled
+            std::vector<std::string> missing_sources;
+            // Every condition, for the unity source properties
+            std::vector<std::string> expanded_sources;
             gen.handle_condition(msources, [&](const std::string &condition, const tsl::ordered_set<std::string> &source_set) {
                 std::vector<std::string> condition_sources;
                 condition_sources.reserve(source_set.size());
                 for (const auto &source : source_set) {
                     condition_sources.push_back(source);
                 }
-                auto sources = expand_cmake_paths(condition_sources, path, is_root_project);
+                std::vector<std::string> sources;
+                {
+                    trace::Scope glob_scope(gen.trace, "glob", target.name, gen.key);
+                    sources = expand_cmake_paths(gen.pool, gen.directories, condition_sources, path, is_root_project,
+                                                 project.project_glob_ignore_files, record);
+                }
                 if (sources.empty()) {
                     auto source_key = condition.empty() ? "sources" : (condition + ".sources");
                     throw_target_error(source_key + " wildcard found 0 files");
                 }
+                expanded_sources.insert(expanded_sources.end(), sources.begin(), sources.end());
 
                 // Make sure there are source files for the languages used by the project
                 switch (target.type) {
@@ -1315,13 +1479,19 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                     }
 
                     // Make sure relative source files exist
-                    for (const auto &source : sources) {
-                        auto var_index = source.find("${");
-                        if (var_index != std::string::npos)
-                            continue;
-                        const auto &source_path = fs::path(path) / source;
-                        if (!fs::exists(source_path)) {
-                            throw_target_error("Source file not found: " + space_error_check(source));
+                    {
+                        trace::Scope check_scope(gen.trace, "check", target.name, gen.key);
+                        for (const auto &source : sources) {
+                            auto var_index = source.find("${");
+                            if (var_index != std::string::npos)
+                                continue;
+                            // The project was parsed from it, but it can be in memory (parser::set_toml)
+                            if (source == "cmake.toml")
+                                continue;
+                            gen.record_parent(source);
+                            if (!gen.directories.exists(fs::path(path) / source)) {
+                                missing_sources.push_back(source);
+                            }
                         }
                     }
                     break;
@@ -1340,6 +1510,16 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                     cmd("list")("APPEND", sources_var, sources);
                 }
             });
+            if (!missing_sources.empty()) {
+                std::string error = missing_sources.size() == 1 ? "Source file not found: " : "Source files not found: ";
+                for (size_t j = 0; j < missing_sources.size(); j++) {
+                    if (j > 0) {
+                        error += ", ";
+                    }
+                    error += space_error_check(missing_sources[j]);
+                }
+                throw_target_error(error);
+            }
 
             auto target_type = target.type;
 
@@ -1485,12 +1665,35 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
 
             gen_target_cmds(target);
 
-            if (!target.properties.empty() || (tmplate != nullptr && !tmplate->outline.properties.empty())) {
+            auto unity = merge_unity(tmplate, target);
+            tsl::ordered_map<std::string, std::string> unity_properties;
+            if (unity.specified) {
+                unity_properties["UNITY_BUILD"] = unity.enable ? "ON" : "OFF";
+            }
+            if (!unity.specified || unity.enable) {
+                if (unity.batch_size >= 0) {
+                    unity_properties["UNITY_BUILD_BATCH_SIZE"] = std::to_string(unity.batch_size);
+                }
+                if (unity.mode == parser::unity_batch) {
+                    unity_properties["UNITY_BUILD_MODE"] = "BATCH";
+                } else if (unity.mode == parser::unity_group) {
+                    unity_properties["UNITY_BUILD_MODE"] = "GROUP";
+                }
+            }
+
+            if (!target.properties.empty() || (tmplate != nullptr && !tmplate->outline.properties.empty()) || !unity_properties.empty()) {
                 auto props = target.properties;
 
                 if (tmplate != nullptr) {
                     props.insert(tmplate->outline.properties.begin(), tmplate->outline.properties.end());
                 }
+                // Properties set explicitly take precedence
+                auto &unconditional = props[""];
+                for (const auto &itr : unity_properties) {
+                    if (unconditional.count(itr.first) == 0) {
+                        unconditional.emplace(itr.first, itr.second);
+                    }
+                }
 
                 gen.handle_condition(props, [&](const std::string &, const tsl::ordered_map<std::string, std::string> &properties) {
                     tsl::ordered_map<std::string, RawArg> raw_properties;
@@ -1507,6 +1710,172 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
                 });
             }
 
+            // Unity source properties, also used when CMAKE_UNITY_BUILD enables unity builds
+            if (!unity.specified || unity.enable) {
+                tsl::ordered_set<std::string> excluded;
+                if (!unity.exclude.empty()) {
+                    trace::Scope glob_scope(gen.trace, "glob", target.name, gen.key);
+                    auto sources = expand_cmake_paths(gen.pool, gen.directories, unity.exclude, path, is_root_project, project.project_glob_ignore_files,
+                                                      record);
+                    if (sources.empty()) {
+                        throw_target_error("unity.exclude wildcard found 0 files");
+                    }
+                    excluded.insert(sources.begin(), sources.end());
+                    cmd("set_source_files_properties")(sources, "PROPERTIES", "SKIP_UNITY_BUILD_INCLUSION", "ON").endl();
+                }
+                if (unity.mode == parser::unity_group) {
+                    tsl::ordered_map<std::string, std::vector<std::string>> groups;
+                    for (const auto &source : expanded_sources) {
+                        auto extension = fs::path(source).extension().string();
+                        if (source.find("${") != std::string::npos || excluded.count(source) != 0 || project_extensions.count(extension) == 0 ||
+                            extension == ".rc" || extension == ".RC") {
+                            continue;
+                        }
+                        auto &group = groups[unity_group(source)];
+                        if (std::find(group.begin(), group.end(), source) == group.end()) {
+                            group.push_back(source);
+                        }
+                    }
+                    for (const auto &itr : groups) {
+                        cmd("set_source_files_properties")(itr.second, "PROPERTIES", "UNITY_GROUP", itr.first);
+                    }
+                    if (!groups.empty()) {
+                        endl();
+                    }
+                }
+            }
+
+            parser::Condition<std::string> lto;
+            if (target_type == parser::target_interface || target_type == parser::target_custom) {
+                if (!target.lto.empty() || (tmplate != nullptr && !tmplate->outline.lto.empty())) {
+                    throw_target_error("lto is not supported for " + std::string(parser::targetTypeNames[target_type]) + " targets");
+                }
+            } else {
+                lto = merge_lto(project, tmplate, target);
+            }
+
+            gen.handle_condition(lto, [&](const std::string &, const std::string &name) {
+                auto mode = parser::parse_ltoMode(name);
+                if (mode == parser::lto_off) {
+                    cmd("set_target_properties")(target.name, "PROPERTIES", "INTERPROCEDURAL_OPTIMIZATION", "OFF");
+                    return;
+                }
+
+                auto clang = RawArg("(CMAKE_C_COMPILER_ID MATCHES \"Clang\" OR CMAKE_CXX_COMPILER_ID MATCHES \"Clang\") AND NOT MSVC");
+                // clang-format off
+                cmd("if")("CMKR_LTO_SUPPORTED");
+                    if (mode == parser::lto_full) {
+                        // CMake uses ThinLTO for Clang, the compile and link steps get -flto=full instead
+                        cmd("if")(clang);
+                            // Libraries pass the link-time optimization on to the targets linking them
+                            auto link_scope = target_type == parser::target_executable || target_type == parser::target_shared ? "PRIVATE" : "PUBLIC";
+                            // Debug builds are not optimized, the link-time optimization would only slow them down
+                            cmd("target_compile_options")(target.name, "PRIVATE", "$<$<NOT:$<CONFIG:Debug>>:-flto=full>");
+                            cmd("target_link_options")(target.name, link_scope, "$<$<NOT:$<CONFIG:Debug>>:-flto=full>");
+                        cmd("else")();
+                            // GCC and MSVC only have a single mode
+                            cmd("set_target_properties")(target.name, "PROPERTIES", "INTERPROCEDURAL_OPTIMIZATION", "ON", "INTERPROCEDURAL_OPTIMIZATION_DEBUG", "OFF");
+                        cmd("endif")();
+                    } else {
+                        // Debug builds are not optimized, the link-time optimization would only slow them down
+                        cmd("set_target_properties")(target.name, "PROPERTIES", "INTERPROCEDURAL_OPTIMIZATION", "ON", "INTERPROCEDURAL_OPTIMIZATION_DEBUG", "OFF");
+                        if (target_type == parser::target_executable || target_type == parser::target_library || target_type == parser::target_shared) {
+                            // Relinking only has to optimize the modules that changed
+                            cmd("if")(clang);
+                                cmd("if")("APPLE");
+                                    cmd("target_link_options")(target.name, "PRIVATE", "$<$<NOT:$<CONFIG:Debug>>:LINKER:-cache_path_lto,${CMAKE_BINARY_DIR}/thinlto-cache>");
+                                cmd("else")();
+                                    cmd("target_link_options")(target.name, "PRIVATE", "$<$<NOT:$<CONFIG:Debug>>:LINKER:--plugin-opt=cache-dir=${CMAKE_BINARY_DIR}/thinlto-cache>");
+                                cmd("endif")();
+                            cmd("endif")();
+                        }
+                    }
+                cmd("endif")();
+                // clang-format on
+            });
+
+            auto pgo_enabled = merge_pgo(tmplate, target);
+            if ((!target.pgo.empty() || (tmplate != nullptr && !tmplate->outline.pgo.empty())) &&
+                (target_type == parser::target_interface || target_type == parser::target_custom)) {
+                throw_target_error("pgo is not supported for " + std::string(parser::targetTypeNames[target_type]) + " targets");
+            }
+
+            gen.handle_condition(pgo_enabled, [&](const std::string &, const std::string &) {
+                // Libraries pass the instrumentation runtime on to the targets linking them
+                auto link_scope = target_type == parser::target_executable || target_type == parser::target_shared ? "PRIVATE" : "PUBLIC";
+                // clang-format off
+                cmd("if")("CMKR_PGO_FLAGS");
+                    cmd("target_compile_options")(target.name, "PRIVATE", "${CMKR_PGO_FLAGS}");
+                    cmd("if")("CMKR_PGO", "STREQUAL", "generate");
+                        cmd("target_link_options")(target.name, link_scope, "${CMKR_PGO_FLAGS}");
+                    cmd("endif")();
+                cmd("endif")();
+                // clang-format on
+            });
+
+            const auto &bolt = merge_bolt(tmplate, target);
+            if (bolt.enable) {
+                if (target_type != parser::target_executable) {
+                    throw_target_error("bolt is only supported for executable targets");
+                }
+                auto file = "$<TARGET_FILE:" + target.name + ">";
+                auto profiles = file + ".bolt-profiles";
+                std::vector<std::string> options = bolt.options;
+                if (options.empty()) {
+                    options = {"-reorder-blocks=ext-tsp", "-reorder-functions=hfsort", "-split-functions", "-split-all-cold", "-dyno-stats"};
+                }
+                auto training = bolt.training;
+                if (training.empty()) {
+                    training.emplace_back();
+                }
+
+                // clang-format off
+                cmd("if")("CMKR_BOLT");
+                    // Function reordering needs the relocations in the executable
+                    cmd("target_link_options")(target.name, "PRIVATE", "LINKER:--emit-relocs");
+                    std::vector<std::pair<std::string, std::vector<RawArg>>> commands;
+                    auto add_command = [&commands](const std::vector<std::string> &arguments) {
+                        commands.emplace_back("COMMAND", std::vector<RawArg>());
+                        for (const auto &argument : arguments) {
+                            commands.back().second.emplace_back(Command::quote(argument));
+                        }
+                    };
+                    add_command({"${CMAKE_COMMAND}", "-E", "remove_directory", profiles});
+                    add_command({"${CMAKE_COMMAND}", "-E", "make_directory", profiles});
+                    add_command({"${CMKR_LLVM_BOLT}", file, "-instrument", "-instrumentation-file-append-pid", "-instrumentation-file=" + profiles + "/profile", "-o",
+                                 file + ".instrumented"});
+                    for (const auto &run : training) {
+                        std::vector<std::string> arguments;
+                        if (!run.working_directory.empty()) {
+                            auto dir = run.working_directory;
+                            gen.record_parent(dir);
+                            if (fs::is_directory(fs::path(path) / dir)) {
+                                dir = "${CMAKE_CURRENT_SOURCE_DIR}/" + dir;
+                            }
+                            arguments = {"${CMAKE_COMMAND}", "-E", "chdir", dir};
+                        }
+                        arguments.push_back(file + ".instrumented");
+                        add_command(arguments);
+                        // Same as [[test]], the arguments are passed as written
+                        for (const auto &argument : run.arguments) {
+                            commands.back().second.emplace_back(argument);
+                        }
+                    }
+                    // Every training process writes its own profile
+                    add_command({"sh", "-c", "\"$0\" \"$1\"/*.fdata > \"$2\"", "${CMKR_MERGE_FDATA}", profiles, file + ".fdata"});
+                    std::vector<std::string> optimize = {"${CMKR_LLVM_BOLT}", file, "-data=" + file + ".fdata", "-o", file + ".bolt"};
+                    optimize.insert(optimize.end(), options.begin(), options.end());
+                    add_command(optimize);
+                    // A generator expression in OUTPUT requires CMake 3.20, the stamp stands in for <target>.bolt
+                    auto stamp = "${CMAKE_CURRENT_BINARY_DIR}/" + target.name + ".bolt.stamp";
+                    add_command({"${CMAKE_COMMAND}", "-E", "touch", stamp});
+                    auto comment = std::make_pair("COMMENT", "Optimizing " + target.name + " with BOLT");
+                    cmd("add_custom_command")(std::make_pair("OUTPUT", stamp), commands, std::make_pair("DEPENDS", target.name), comment, "VERBATIM");
+                    cmd("add_custom_target")(target.name + "-bolt", "ALL", std::make_pair("DEPENDS", stamp));
+                cmd("endif")().endl();
+                // clang-format on
+            }
+
             // The first executable target will become the Visual Studio startup project
             // TODO: this is not working properly
             if (target_type == parser::target_executable) {
@@ -1531,26 +1900,44 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
         }
     }
 
-    if (!project.tests.empty()) {
-        cmd("enable_testing")().endl();
-        for (const auto &test : project.tests) {
-            auto name = std::make_pair("NAME", test.name);
-            auto configurations = std::make_pair("CONFIGURATIONS", test.configurations);
-            auto dir = test.working_directory;
-            if (fs::is_directory(fs::path(path) / dir)) {
-                dir = "${CMAKE_CURRENT_LIST_DIR}/" + dir;
-            }
-            auto working_directory = std::make_pair("WORKING_DIRECTORY", dir);
-            auto command = std::make_pair("COMMAND", test.command);
-
-            // Transform the provided arguments into raw arguments to prevent them from being quoted when the generator runs
-            std::vector<RawArg> raw_arguments{};
-            for (const auto &argument : test.arguments)
-                raw_arguments.emplace_back(argument);
-            auto arguments = std::make_pair("", raw_arguments);
-            ConditionScope cs(gen, test.condition);
+    auto add_test = [&](const parser::Test &test, const std::string &label) {
+        auto name = std::make_pair("NAME", test.name);
+        auto configurations = std::make_pair("CONFIGURATIONS", test.configurations);
+        auto dir = test.working_directory;
+        gen.record_parent(dir);
+        if (fs::is_directory(fs::path(path) / dir)) {
+            dir = "${CMAKE_CURRENT_LIST_DIR}/" + dir;
+        }
+        auto working_directory = std::make_pair("WORKING_DIRECTORY", dir);
+        auto command = std::make_pair("COMMAND", test.command);
+
+        // Transform the provided arguments into raw arguments to prevent them from being quoted when the generator runs
+        std::vector<RawArg> raw_arguments{};
+        for (const auto &argument : test.arguments)
+            raw_arguments.emplace_back(argument);
+        auto arguments = std::make_pair("", raw_arguments);
+        ConditionScope cs(gen, test.condition);
+        if (label.empty()) {
             cmd("add_test")(name, configurations, working_directory, command, arguments).endl();
+        } else {
+            cmd("add_test")(name, configurations, working_directory, command, arguments);
+            cmd("set_tests_properties")(test.name, "PROPERTIES", "LABELS", label);
         }
+    };
+
+    if (!project.tests.empty() || !project.pgo_trainings.empty()) {
+        cmd("enable_testing")().endl();
+    }
+    for (const auto &test : project.tests) {
+        add_test(test, "");
+    }
+    if (!project.pgo_trainings.empty()) {
+        comment("Profile-guided optimization training, run by cmkr build --pgo");
+        cmd("if")("CMKR_PGO", "STREQUAL", "generate");
+        for (const auto &test : project.pgo_trainings) {
+            add_test(test, "cmkr-pgo-training");
+        }
+        cmd("endif")().endl();
     }
 
     if (!project.installs.empty()) {
@@ -1559,12 +1946,14 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
             auto dirs = std::make_pair("DIRS", inst.dirs);
             std::vector<std::string> files_data;
             if (!inst.files.empty()) {
-                files_data = expand_cmake_paths(inst.files, path, is_root_project);
+                trace::Scope glob_scope(gen.trace, "glob", "install", gen.key);
+                files_data = expand_cmake_paths(gen.pool, gen.directories, inst.files, path, is_root_project, project.project_glob_ignore_files,
+                                                record);
                 if (files_data.empty()) {
                     throw std::runtime_error("[[install]] files wildcard did not resolve to any files");
                 }
             }
-            auto files = std::make_pair("FILES", inst.files);
+            auto files = std::make_pair("FILES", files_data);
             auto configs = std::make_pair("CONFIGURATIONS", inst.configs);
             auto destination = std::make_pair("DESTINATION", inst.destination);
             auto component_name = inst.component;
@@ -1574,12 +1963,53 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
             auto component = std::make_pair("COMPONENT", component_name);
             auto optional = inst.optional ? "OPTIONAL" : "";
             ConditionScope cs(gen, inst.condition);
-            cmd("install")(targets, dirs, files, configs, destination, component, optional);
+
+            // With BOLT the optimized <target>.bolt is installed instead of the executable
+            std::vector<std::string> unoptimized;
+            std::vector<std::pair<std::string, std::string>> optimized;
+            for (const auto &name : inst.targets) {
+                auto target =
+                    std::find_if(project.targets.begin(), project.targets.end(), [&name](const parser::Target &t) { return t.name == name; });
+                if (target != project.targets.end()) {
+                    const parser::Template *tmplate = nullptr;
+                    if (target->type == parser::target_template) {
+                        tmplate = project.find_template(target->type_name);
+                    }
+                    const auto &bolt = merge_bolt(tmplate, *target);
+                    if (bolt.enable && bolt.install) {
+                        optimized.emplace_back(name, output_name(tmplate, *target));
+                        continue;
+                    }
+                }
+                unoptimized.push_back(name);
+            }
+            if (optimized.empty()) {
+                cmd("install")(targets, dirs, files, configs, destination, component, optional);
+                continue;
+            }
+
+            // clang-format off
+            cmd("if")("CMKR_BOLT");
+                if (!unoptimized.empty() || !dirs.second.empty() || !files_data.empty()) {
+                    cmd("install")(std::make_pair("TARGETS", unoptimized), dirs, files, configs, destination, component, optional);
+                }
+                for (const auto &itr : optimized) {
+                    auto programs = std::make_pair("PROGRAMS", "$<TARGET_FILE:" + itr.first + ">.bolt");
+                    // A generator expression in RENAME requires CMake 3.20
+                    auto rename = std::make_pair("RENAME", itr.second);
+                    cmd("install")(programs, configs, destination, rename, component, optional);
+                }
+            cmd("else")();
+                cmd("install")(targets, dirs, files, configs, destination, component, optional);
+            cmd("endif")();
+            // clang-format on
         }
     }
 
-    // Fetch the generated CMakeLists.txt output from the stringstream buffer
+    // Fetch the generated CMakeLists.txt output from the buffer
     auto generated_cmake = ss.str();
+    emit_scope.reset();
+    trace::Scope write_scope(trace, "write", "CMakeLists.txt", key);
 
     // Make sure the file ends in a single newline
     while (!generated_cmake.empty() && std::isspace(generated_cmake.back())) {
@@ -1590,45 +2020,387 @@ void generate_cmake(const char *path, const parser::Project *parent_project) {
     // Generate CMakeLists.txt
     auto list_path = fs::path(path) / "CMakeLists.txt";
 
-    auto should_regenerate = [&list_path, &generated_cmake]() {
-        if (!fs::exists(list_path))
-            return true;
+    output.update(list_path, generated_cmake);
+
+    if (record != nullptr) {
+        record->outputs["CMakeLists.txt"] = manifest::hash_string(generated_cmake);
+    }
+}
+
+// A directory with a cmake.toml, generated concurrently with its siblings
+struct Subproject {
+    std::string path;
+    const parser::Project *parent = nullptr;
+    std::unique_ptr<parser::Project> project;
+    std::vector<std::unique_ptr<Subproject>> children;
+    std::exception_ptr error;
+    std::vector<std::pair<fs::path, std::string>> pending;
+    // Only filled when the generated files are reported
+    std::vector<OutputFile> outputs;
+
+    // Incremental generation state
+    std::string key = ".";
+    std::string scope;
+    manifest::Directory record;
+    bool up_to_date = false;
+};
 
-        std::ifstream ifs(list_path, std::ios::binary);
-        if (!ifs.is_open()) {
-            throw std::runtime_error("Failed to read " + list_path.string());
+// State shared by all the subprojects of a single generation
+struct Context {
+    dircache::DirectoryCache *directories = nullptr;
+    // Only set when incremental generation is enabled
+    manifest::Manifest *previous = nullptr;
+    // Only set when tracing is enabled
+    trace::Recorder *trace = nullptr;
+    bool write = true;
+    bool report = false;
+};
+
+static void generate_subproject(pool::TaskGroup &group, Subproject &subproject, Context &context);
+
+static void generate_children(pool::TaskGroup &group, Subproject &subproject, Context &context) {
+    for (const auto &child : subproject.children) {
+        auto child_ptr = child.get();
+        group.run([&group, child_ptr, &context]() {
+            generate_subproject(group, *child_ptr, context);
+        });
+    }
+}
+
+// The files of the directory are unchanged, only (some of) its subdirectories are generated again
+static void reuse_directory(Subproject &subproject, const manifest::Directory &previous) {
+    subproject.record = previous;
+    for (const auto &subdir : previous.subdirs) {
+        if (!subdir.generated) {
+            continue;
+        }
+        auto relative = subproject.key == "." ? subdir.key : subdir.key.substr(subproject.key.size() + 1);
+        std::unique_ptr<Subproject> child(new Subproject);
+        child->path = (fs::path(subproject.path) / relative).string();
+        child->parent = subproject.project.get();
+        child->key = subdir.key;
+        child->scope = manifest::Manifest::subdir_scope(subproject.scope, previous.toml);
+        subproject.children.push_back(std::move(child));
+    }
+}
+
+static void generate_subproject(pool::TaskGroup &group, Subproject &subproject, Context &context) {
+    const auto previous = context.previous;
+    const auto trace = context.trace;
+    try {
+        trace::Scope directory_scope(trace, "directory", subproject.key, subproject.key);
+        if (previous != nullptr && previous->tree_up_to_date(subproject.key, subproject.scope)) {
+            subproject.up_to_date = true;
+            return;
         }
 
-        std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        return data != generated_cmake;
-    }();
+        const auto &path = subproject.path;
+        auto record = previous != nullptr ? &subproject.record : nullptr;
+        if (record != nullptr) {
+            // The hash is of the same contents the project is parsed from
+            record->scope = subproject.scope;
+            record->toml = parser::toml_hash(path);
+        }
+
+        {
+            trace::Scope parse_scope(trace, "parse", "cmake.toml", subproject.key);
+            subproject.project.reset(new parser::Project(subproject.parent, path, false));
+        }
+        const auto &project = *subproject.project;
+
+        // Still parsed, the subdirectories look up templates and conditions through it
+        if (previous != nullptr && previous->directory_up_to_date(subproject.key, subproject.scope)) {
+            reuse_directory(subproject, *previous->find(subproject.key));
+            generate_children(group, subproject, context);
+            return;
+        }
+
+        Output output;
+        output.write = context.write;
+        output.pending = &subproject.pending;
+        output.files = context.report ? &subproject.outputs : nullptr;
+        generate_cmakelists(project, path, group.pool(), *context.directories, record, trace, subproject.key, output);
+
+        auto add_subdir = [&](const fs::path &sub) {
+            manifest::Subdir subdir;
+            subdir.key = manifest::Manifest::subdir_key(subproject.key, sub);
+
+            auto skip = [&]() {
+                if (record != nullptr) {
+                    subdir.toml = parser::toml_hash((path / sub).string());
+                    record->subdirs.push_back(subdir);
+                }
+            };
+
+            // Skip generating for subdirectories that have a cmake.toml with a [project] in it
+            fs::path subpath;
+            for (const auto &p : sub) {
+                subpath /= p;
+                if (parser::is_root_path((path / subpath).string())) {
+                    skip();
+                    return;
+                }
+            }
 
-    if (should_regenerate) {
-        create_file(list_path, generated_cmake);
+            subpath = path / sub;
+            if (fs::exists(subpath / "cmake.toml")) {
+                std::unique_ptr<Subproject> child(new Subproject);
+                child->path = subpath.string();
+                child->parent = &project;
+                child->key = subdir.key;
+                if (record != nullptr) {
+                    child->scope = manifest::Manifest::subdir_scope(subproject.scope, record->toml);
+                    subdir.generated = true;
+                    record->subdirs.push_back(subdir);
+                }
+                subproject.children.push_back(std::move(child));
+            } else {
+                skip();
+            }
+        };
+        trace::Scope subdirs_scope(trace, "subdirs", "subdirs", subproject.key);
+        for (const auto &itr : project.project_subdirs) {
+            for (const auto &sub : itr.second) {
+                add_subdir(sub);
+            }
+        }
+        for (const auto &subdir : project.subdirs) {
+            add_subdir(subdir.name);
+        }
+    } catch (...) {
+        subproject.error = std::current_exception();
+        return;
+    }
+
+    generate_children(group, subproject, context);
+}
+
+// Write the files a serial depth-first generation would have written before its first error,
+// the directories after it were generated concurrently but are left untouched
+static bool write_pending(const Subproject &subproject) {
+    for (const auto &itr : subproject.pending) {
+        files::write(itr.first, itr.second);
     }
+    if (subproject.error) {
+        return false;
+    }
+    for (const auto &child : subproject.children) {
+        if (!write_pending(*child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Report the error that a serial depth-first generation would have encountered first
+static void rethrow_first_error(const Subproject &subproject) {
+    if (subproject.error) {
+        std::rethrow_exception(subproject.error);
+    }
+    for (const auto &child : subproject.children) {
+        rethrow_first_error(*child);
+    }
+}
 
-    auto generate_subdir = [path, &project](const fs::path &sub) {
-        // Skip generating for subdirectories that have a cmake.toml with a [project] in it
-        fs::path subpath;
-        for (const auto &p : sub) {
-            subpath /= p;
-            if (parser::is_root_path((path / subpath).string())) {
-                return;
+static void collect_manifest(const Subproject &subproject, const manifest::Manifest &previous, manifest::Manifest &current) {
+    if (subproject.up_to_date) {
+        current.copy_tree(previous, subproject.key);
+        return;
+    }
+    current.insert(subproject.key, subproject.record);
+    for (const auto &child : subproject.children) {
+        collect_manifest(*child, previous, current);
+    }
+}
+
+static void collect_paths(const Subproject &subproject, std::vector<std::string> &paths) {
+    paths.push_back(subproject.path);
+    for (const auto &child : subproject.children) {
+        collect_paths(*child, paths);
+    }
+}
+
+static void collect_outputs(Subproject &subproject, std::vector<OutputFile> &outputs) {
+    for (auto &output : subproject.outputs) {
+        outputs.push_back(std::move(output));
+    }
+    for (const auto &child : subproject.children) {
+        collect_outputs(*child, outputs);
+    }
+}
+
+// Read by the cmkr() macro in cmkr.cmake, which skips running cmkr gen when the
+// version, every file and the timestamp of every listed directory still match.
+// Returns false (and writes nothing) if the paths cannot be stored in the stamp.
+static bool write_stamp(const fs::path &file, const fs::path &root, const manifest::Manifest &manifest, dircache::DirectoryCache &directories) {
+    tsl::ordered_map<std::string, std::string> hashes;
+    tsl::ordered_map<std::string, std::string> timestamps;
+    auto absolute = [&root](const std::string &key, const std::string &relative) {
+        auto path = fs::absolute(root / key / relative).lexically_normal().generic_string();
+        if (path.size() > 1 && path.back() == '/') {
+            path.pop_back();
+        }
+        return path;
+    };
+    auto add_file = [&hashes](const std::string &path) {
+        if (!hashes.contains(path)) {
+            hashes.emplace(path, sha256::hash_file(path));
+        }
+    };
+    for (const auto &itr : manifest.directories()) {
+        const auto &directory = itr.second;
+        add_file(absolute(itr.first, "cmake.toml"));
+        for (const auto &jtr : directory.inputs) {
+            add_file(absolute(itr.first, jtr.first));
+        }
+        for (const auto &jtr : directory.outputs) {
+            add_file(absolute(itr.first, jtr.first));
+        }
+        for (const auto &subdir : directory.subdirs) {
+            if (!subdir.generated) {
+                add_file(absolute(subdir.key, "cmake.toml"));
+            }
+        }
+        for (const auto &jtr : directory.listings) {
+            timestamps.emplace(absolute(itr.first, jtr.first), "");
+            // The target of a link to a file can be (re)moved without changing the directory
+            auto listing = (root / itr.first / jtr.first).lexically_normal();
+            for (const auto &entry : directories.list(listing)->entries) {
+                if (entry.is_symlink && !entry.is_directory) {
+                    add_file(absolute(itr.first, jtr.first + "/" + entry.name));
+                }
             }
         }
+    }
+
+    // Seconds since the epoch, like file(TIMESTAMP <path> <var> "%s" UTC). Missing
+    // directories keep an empty timestamp.
+    auto now = time(nullptr);
+    for (auto itr = timestamps.begin(); itr != timestamps.end(); ++itr) {
+        struct stat st;
+        if (stat(itr->first.c_str(), &st) != 0) {
+            continue;
+        }
+        // A change within the same second would go unnoticed, the next configure
+        // generates again and stores the timestamp once the directory settled
+        if (now - st.st_mtime < 2) {
+            itr.value() = "racy";
+            continue;
+        }
+        itr.value() = std::to_string(static_cast<long long>(st.st_mtime));
+    }
 
-        subpath = path / sub;
-        if (fs::exists(subpath / "cmake.toml")) {
-            generate_cmake(subpath.string().c_str(), &project);
+    std::string stamp = "# Generated by cmkr gen - DO NOT EDIT\n";
+    stamp += "set(CMKR_STAMP_VERSION " + Command::quote(help::version()) + ")\n";
+    auto append = [&stamp](const char *variable, const tsl::ordered_map<std::string, std::string> &values) {
+        stamp += "set(" + std::string(variable) + '\n';
+        for (const auto &itr : values) {
+            // The paths are iterated as a CMake list
+            if (itr.first.find(';') != std::string::npos) {
+                return false;
+            }
+            stamp += '\t' + Command::quote(itr.first) + " \"" + itr.second + "\"\n";
         }
+        stamp += ")\n";
+        return true;
     };
-    for (const auto &itr : project.project_subdirs) {
-        for (const auto &sub : itr.second) {
-            generate_subdir(sub);
+    if (!append("CMKR_STAMP_FILES", hashes) || !append("CMKR_STAMP_DIRECTORIES", timestamps)) {
+        return false;
+    }
+    files::update(file, stamp);
+    return true;
+}
+
+void generate_cmake(const char *path, const Options &options) {
+    // Also finds a cmake.toml set with parser::set_toml
+    if (parser::toml_hash(path) == "-") {
+        throw std::runtime_error("No cmake.toml found!");
+    }
+    if (!options.write && !options.cache_dir.empty()) {
+        throw std::runtime_error("The generation cache requires writing the generated files");
+    }
+
+    Context context;
+    context.write = options.write;
+    context.report = options.outputs != nullptr;
+    std::unique_ptr<trace::Recorder> recorder;
+    if (options.recorder != nullptr) {
+        context.trace = options.recorder;
+    } else if (!options.trace.empty()) {
+        recorder.reset(new trace::Recorder);
+        context.trace = recorder.get();
+    }
+
+    dircache::DirectoryCache directories;
+    std::unique_ptr<manifest::Manifest> previous;
+    fs::path cache_dir(options.cache_dir);
+    if (options.session != nullptr) {
+        // The listings of the directories that changed were invalidated by cmkr watch
+        trace::Scope validate_scope(context.trace, "cache", "validate");
+        context.directories = &options.session->directories;
+        context.previous = &options.session->manifest;
+        context.previous->validate(*context.directories, path);
+    } else {
+        context.directories = &directories;
+        if (!options.cache_dir.empty()) {
+            trace::Scope load_scope(context.trace, "cache", "load");
+            directories.load(cache_dir / "directories.txt");
+            previous.reset(new manifest::Manifest);
+            if (previous->load(cache_dir / "manifest.txt")) {
+                previous->validate(directories, path);
+            }
+            context.previous = previous.get();
         }
     }
-    for (const auto &subdir : project.subdirs) {
-        generate_subdir(subdir.name);
+
+    Subproject root;
+    root.path = path;
+    {
+        pool::ThreadPool thread_pool(options.jobs);
+        pool::TaskGroup group(thread_pool);
+        group.run([&group, &root, &context]() {
+            generate_subproject(group, root, context);
+        });
+        group.wait();
+    }
+    if (options.session != nullptr) {
+        options.session->visited.clear();
+        collect_paths(root, options.session->visited);
+    }
+    write_pending(root);
+    rethrow_first_error(root);
+    if (options.outputs != nullptr) {
+        collect_outputs(root, *options.outputs);
+    }
+
+    if (options.session != nullptr) {
+        manifest::Manifest current;
+        collect_manifest(root, *context.previous, current);
+        options.session->manifest = std::move(current);
+    } else if (context.previous != nullptr) {
+        trace::Scope save_scope(context.trace, "cache", "save");
+        manifest::Manifest current;
+        collect_manifest(root, *context.previous, current);
+        current.save(cache_dir / "manifest.txt");
+        directories.save(cache_dir / "directories.txt");
+
+        auto stamp_file = cache_dir / "cmkr-stamp.cmake";
+        if (!write_stamp(stamp_file, path, current, directories)) {
+            std::error_code ec;
+            fs::remove(stamp_file, ec);
+        }
+    }
+
+    if (options.stats) {
+        auto stats = context.directories->stats();
+        printf("[stats] readdir: %zu calls, %zu saved\n", stats.readdir_calls, stats.readdir_saved);
+        printf("[stats] stat: %zu calls, %zu saved\n", stats.stat_calls, stats.stat_saved);
+        printf("[stats] exists: %zu checks, %zu saved\n", stats.exists_checks, stats.exists_checks - stats.exists_calls);
+    }
+
+    if (recorder) {
+        recorder->write_chrome(options.trace);
+        recorder->print_summary(10);
     }
 }
 } // namespace gen
@@ -0,0 +1,56 @@
+#include "diagnostics.hpp"
+
+#include <cstdio>
+#include <mutex>
+
+namespace cmkr {
+namespace diag {
+
+static std::mutex collector_mutex;
+static std::vector<Diagnostic> *collector = nullptr;
+
+Diagnostic::Diagnostic(Severity severity, std::string text) : severity(severity), text(std::move(text)) {
+    message = this->text.substr(0, this->text.find('\n'));
+    for (auto prefix : {"[warning] ", "[error] "}) {
+        std::string prefix_str(prefix);
+        if (message.compare(0, prefix_str.size(), prefix_str) == 0) {
+            message.erase(0, prefix_str.size());
+            break;
+        }
+    }
+}
+
+Error::Error(Diagnostic diagnostic) : std::runtime_error(diagnostic.text), m_diagnostic(std::move(diagnostic)) {
+}
+
+void warning(Diagnostic diagnostic) {
+    std::lock_guard<std::mutex> lock(collector_mutex);
+    if (collector != nullptr) {
+        collector->push_back(std::move(diagnostic));
+    } else {
+        puts(diagnostic.text.c_str());
+    }
+}
+
+Collector::Collector() {
+    std::lock_guard<std::mutex> lock(collector_mutex);
+    if (collector != nullptr) {
+        throw std::logic_error("Only one diagnostics collector can be active");
+    }
+    collector = &m_diagnostics;
+}
+
+Collector::~Collector() {
+    std::lock_guard<std::mutex> lock(collector_mutex);
+    collector = nullptr;
+}
+
+std::vector<Diagnostic> Collector::take() {
+    std::lock_guard<std::mutex> lock(collector_mutex);
+    std::vector<Diagnostic> diagnostics;
+    diagnostics.swap(m_diagnostics);
+    return diagnostics;
+}
+
+} // namespace diag
+} // namespace cmkr
@@ -0,0 +1,251 @@
+#include "directory_cache.hpp"
+#include "files.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace cmkr {
+namespace dircache {
+
+// Returns false if the directory does not exist
+static bool directory_mtime(const fs::path &directory, long long &mtime, bool &racy) {
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        return false;
+    }
+    auto time = fs::last_write_time(directory, ec);
+    if (ec) {
+        return false;
+    }
+    mtime = static_cast<long long>(time.time_since_epoch().count());
+    // Changes within the timestamp resolution would go unnoticed
+    racy = fs::file_time_type::clock::now() - time < std::chrono::seconds(2);
+    return true;
+}
+
+std::shared_ptr<const Snapshot> DirectoryCache::read(const fs::path &directory, const std::string &key) {
+    std::shared_ptr<Snapshot> snapshot(new Snapshot);
+    size_t stat_calls = 1;
+
+    std::shared_ptr<const Snapshot> persisted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto itr = m_persisted.find(key);
+        if (itr != m_persisted.end()) {
+            persisted = itr->second;
+        }
+    }
+
+    snapshot->exists = directory_mtime(directory, snapshot->mtime, snapshot->racy);
+    if (snapshot->exists && persisted && persisted->mtime == snapshot->mtime) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.stat_calls += stat_calls;
+        m_stats.stat_saved += persisted->entries.size();
+        m_stats.readdir_saved++;
+        return persisted;
+    }
+
+    if (snapshot->exists) {
+        std::error_code ec;
+        fs::directory_iterator itr(directory, fs::directory_options::follow_directory_symlink, ec);
+        if (ec) {
+            snapshot->exists = false;
+        }
+        for (; !ec && itr != fs::directory_iterator(); itr.increment(ec)) {
+            Entry entry;
+            entry.name = itr->path().filename().string();
+            std::error_code type_ec;
+            entry.is_directory = itr->is_directory(type_ec);
+            entry.is_symlink = itr->is_symlink(type_ec);
+            snapshot->entries.push_back(std::move(entry));
+        }
+        stat_calls += snapshot->entries.size();
+        std::sort(snapshot->entries.begin(), snapshot->entries.end(), [](const Entry &a, const Entry &b) {
+            return a.name < b.name;
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.stat_calls += stat_calls;
+    m_stats.readdir_calls++;
+    return snapshot;
+}
+
+std::shared_ptr<const Snapshot> DirectoryCache::lookup(const fs::path &directory, bool count_saved) {
+    auto key = directory.lexically_normal().generic_string();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto itr = m_snapshots.find(key);
+        if (itr != m_snapshots.end()) {
+            if (count_saved) {
+                m_stats.readdir_saved++;
+                m_stats.stat_saved += itr->second->entries.size();
+            }
+            return itr->second;
+        }
+    }
+
+    // Read without holding the lock, another thread listing the same directory
+    // at the same time only wastes some work
+    auto snapshot = read(directory, key);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshots.emplace(key, snapshot).first->second;
+}
+
+std::shared_ptr<const Snapshot> DirectoryCache::list(const fs::path &directory) {
+    return lookup(directory, true);
+}
+
+bool DirectoryCache::exists(const fs::path &file) {
+    auto normal = file.lexically_normal();
+    auto name = normal.filename().string();
+    auto listed = !name.empty() && name != "." && name != "..";
+    for (const auto &part : file) {
+        // The listing of a directory reached through .. can differ from what the OS resolves
+        listed = listed && part != "..";
+    }
+
+    const Entry *entry = nullptr;
+    if (listed) {
+        auto parent = normal.parent_path();
+        auto listing = lookup(parent.empty() ? fs::path(".") : parent, false);
+        auto itr = std::lower_bound(listing->entries.begin(), listing->entries.end(), name, [](const Entry &lhs, const std::string &rhs) {
+            return lhs.name < rhs;
+        });
+        if (itr != listing->entries.end() && itr->name == name) {
+            entry = &*itr;
+        }
+    }
+
+    // A symbolic link to a file can be broken
+    auto confirmed = entry != nullptr && !(entry->is_symlink && !entry->is_directory);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.exists_checks++;
+        if (!confirmed) {
+            m_stats.exists_calls++;
+        }
+    }
+    if (confirmed) {
+        return true;
+    }
+    std::error_code ec;
+    return fs::exists(file, ec);
+}
+
+bool DirectoryCache::file_hash(const fs::path &file, std::string &hash) const {
+    auto normal = file.lexically_normal();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto directory = m_hashes.find(normal.parent_path().generic_string());
+    if (directory == m_hashes.end()) {
+        return false;
+    }
+    auto itr = directory->second.find(normal.filename().string());
+    if (itr == directory->second.end()) {
+        return false;
+    }
+    hash = itr->second;
+    return true;
+}
+
+void DirectoryCache::set_file_hash(const fs::path &file, const std::string &hash) {
+    auto normal = file.lexically_normal();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hashes[normal.parent_path().generic_string()][normal.filename().string()] = hash;
+}
+
+void DirectoryCache::invalidate(const fs::path &directory) {
+    auto key = directory.lexically_normal().generic_string();
+    while (key.size() > 1 && key.back() == '/') {
+        key.pop_back();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Listed with and without a trailing separator
+    for (const auto &name : {key, key + "/"}) {
+        m_snapshots.erase(name);
+        m_hashes.erase(name);
+    }
+}
+
+bool DirectoryCache::load(const fs::path &file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_persisted.clear();
+
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(ifs, line) || line != "cmkr-directories 2") {
+        return false;
+    }
+
+    std::shared_ptr<Snapshot> snapshot;
+    while (std::getline(ifs, line)) {
+        // directory <mtime> <path>
+        // entry <d|l|s|f> <name> (l is a symbolic link to a directory, s any other symbolic link)
+        auto first = line.find(' ');
+        auto second = first == std::string::npos ? std::string::npos : line.find(' ', first + 1);
+        if (second == std::string::npos || first == 0) {
+            m_persisted.clear();
+            return false;
+        }
+        auto type = line.substr(0, first);
+        auto value = line.substr(first + 1, second - first - 1);
+        auto name = line.substr(second + 1);
+        if (type == "directory") {
+            if (value.empty() || value.find_first_not_of("-0123456789") != std::string::npos) {
+                m_persisted.clear();
+                return false;
+            }
+            snapshot.reset(new Snapshot);
+            snapshot->exists = true;
+            snapshot->mtime = std::stoll(value);
+            m_persisted[name] = snapshot;
+        } else if (type == "entry" && snapshot) {
+            Entry entry;
+            entry.name = name;
+            entry.is_directory = value == "d" || value == "l";
+            entry.is_symlink = value == "l" || value == "s";
+            snapshot->entries.push_back(std::move(entry));
+        } else {
+            m_persisted.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void DirectoryCache::save(const fs::path &file) const {
+    std::ostringstream oss;
+    oss << "cmkr-directories 2\n";
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &itr : m_snapshots) {
+            const auto &snapshot = *itr.second;
+            if (!snapshot.exists || snapshot.racy) {
+                continue;
+            }
+            oss << "directory " << snapshot.mtime << ' ' << itr.first << '\n';
+            for (const auto &entry : snapshot.entries) {
+                auto type = entry.is_directory ? (entry.is_symlink ? 'l' : 'd') : (entry.is_symlink ? 's' : 'f');
+                oss << "entry " << type << ' ' << entry.name << '\n';
+            }
+        }
+    }
+
+    files::update(file, oss.str());
+}
+
+Stats DirectoryCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace dircache
+} // namespace cmkr
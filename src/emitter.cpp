@@ -0,0 +1,39 @@
+#include "emitter.hpp"
+
+namespace cmkr {
+namespace gen {
+
+void Buffer::quoted(const char *str, size_t size) {
+    // Quote an empty string
+    if (size == 0) {
+        m_data.append("\"\"");
+        return;
+    }
+
+    // Don't quote arguments that don't need quoting
+    // https://cmake.org/cmake/help/latest/manual/cmake-language.7.html#unquoted-argument
+    // NOTE: Normally '/' does not require quoting according to the documentation but this has been the case here
+    //       previously, so for backwards compatibility its still here.
+    static const char special[] = "()#\"\\'> |/;";
+    auto needs_quotes = false;
+    for (size_t i = 0; i < size && !needs_quotes; i++) {
+        needs_quotes = memchr(special, str[i], sizeof(special) - 1) != nullptr;
+    }
+    if (!needs_quotes) {
+        m_data.append(str, size);
+        return;
+    }
+
+    m_data += '\"';
+    for (size_t i = 0; i < size; i++) {
+        auto ch = str[i];
+        if (ch == '\\' || ch == '\"') {
+            m_data += '\\';
+        }
+        m_data += ch;
+    }
+    m_data += '\"';
+}
+
+} // namespace gen
+} // namespace cmkr
@@ -0,0 +1,167 @@
+#include "files.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cmkr {
+namespace files {
+
+bool try_read(const fs::path &path, std::string &contents) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    ifs.seekg(0, std::ios::end);
+    auto size = ifs.tellg();
+    if (size < 0) {
+        return false;
+    }
+    contents.resize(static_cast<size_t>(size));
+    ifs.seekg(0, std::ios::beg);
+    ifs.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+    contents.resize(static_cast<size_t>(ifs.gcount()));
+    return true;
+}
+
+std::string read(const fs::path &path) {
+    std::string contents;
+    if (!try_read(path, contents)) {
+        throw std::runtime_error("Failed to read " + path.string());
+    }
+    return contents;
+}
+
+// Reading small files into a buffer is cheaper than setting up a mapping, only
+// large files are mapped (in chunks, so the mapping stays bounded)
+static const size_t buffer_size = 64 * 1024;
+static const size_t map_threshold = 1024 * 1024;
+static const size_t map_chunk_size = 4 * 1024 * 1024;
+
+#ifdef _WIN32
+bool equals(const fs::path &path, const std::string &contents) {
+    std::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec || size != contents.size()) {
+        return false;
+    }
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    std::vector<char> buffer(buffer_size);
+    for (size_t offset = 0; offset < contents.size();) {
+        auto length = std::min(buffer.size(), contents.size() - offset);
+        ifs.read(buffer.data(), static_cast<std::streamsize>(length));
+        if (static_cast<size_t>(ifs.gcount()) != length || memcmp(buffer.data(), contents.data() + offset, length) != 0) {
+            return false;
+        }
+        offset += length;
+    }
+    return true;
+}
+#else
+static bool equals_mapped(int fd, const std::string &contents) {
+    for (size_t offset = 0; offset < contents.size(); offset += map_chunk_size) {
+        auto length = std::min(map_chunk_size, contents.size() - offset);
+        auto data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        auto same = memcmp(data, contents.data() + offset, length) == 0;
+        munmap(data, length);
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool equals_buffered(int fd, const std::string &contents) {
+    char buffer[buffer_size];
+    for (size_t offset = 0; offset < contents.size();) {
+        auto length = ::read(fd, buffer, std::min(sizeof(buffer), contents.size() - offset));
+        if (length <= 0 || memcmp(buffer, contents.data() + offset, static_cast<size_t>(length)) != 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(length);
+    }
+    return true;
+}
+
+bool equals(const fs::path &path, const std::string &contents) {
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    auto same = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == contents.size();
+    if (same) {
+        same = contents.size() >= map_threshold ? equals_mapped(fd, contents) : equals_buffered(fd, contents);
+    }
+    close(fd);
+    return same;
+}
+#endif
+
+static std::string temporary_suffix() {
+    // Unique between threads and concurrent cmkr processes
+    static std::atomic<unsigned int> counter(0);
+#ifdef _WIN32
+    auto pid = _getpid();
+#else
+    auto pid = getpid();
+#endif
+    return ".cmkr-" + std::to_string(pid) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+void write(const fs::path &path, const std::string &contents) {
+    if (!path.parent_path().empty()) {
+        fs::create_directories(path.parent_path());
+    }
+
+    auto temporary = path;
+    temporary += temporary_suffix();
+    {
+        std::ofstream ofs(temporary, std::ios::binary);
+        if (ofs) {
+            ofs.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            ofs.close();
+        }
+        if (!ofs) {
+            std::error_code ec;
+            fs::remove(temporary, ec);
+            throw std::runtime_error("Failed to create " + path.string());
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temporary, path, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        throw std::runtime_error("Failed to create " + path.string());
+    }
+}
+
+bool update(const fs::path &path, const std::string &contents) {
+    if (equals(path, contents)) {
+        return false;
+    }
+    write(path, contents);
+    return true;
+}
+
+} // namespace files
+} // namespace cmkr
@@ -0,0 +1,546 @@
+#include "glob.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace cmkr {
+namespace glob {
+
+bool is_pattern(const std::string &path) {
+    if (path.find("${") != std::string::npos || path.find("$<") != std::string::npos) {
+        return false;
+    }
+    return path.find_first_of("*?[{") != std::string::npos;
+}
+
+std::vector<std::string> expand_braces(const std::string &pattern) {
+    // Find the first brace group with a comma at its own nesting level
+    for (auto open = pattern.find('{'); open != std::string::npos; open = pattern.find('{', open + 1)) {
+        int depth = 0;
+        auto close = std::string::npos;
+        std::vector<size_t> commas;
+        for (auto i = open; i < pattern.size(); i++) {
+            auto c = pattern[i];
+            if (c == '{') {
+                depth++;
+            } else if (c == '}') {
+                if (--depth == 0) {
+                    close = i;
+                    break;
+                }
+            } else if (c == ',' && depth == 1) {
+                commas.push_back(i);
+            }
+        }
+        if (close == std::string::npos) {
+            // Unbalanced braces are matched literally
+            break;
+        }
+        if (commas.empty()) {
+            continue;
+        }
+
+        auto prefix = pattern.substr(0, open);
+        auto suffix = pattern.substr(close + 1);
+        commas.push_back(close);
+
+        std::vector<std::string> result;
+        auto start = open + 1;
+        for (auto comma : commas) {
+            for (const auto &alternative : expand_braces(prefix + pattern.substr(start, comma - start) + suffix)) {
+                result.push_back(alternative);
+            }
+            start = comma + 1;
+        }
+        return result;
+    }
+    return {pattern};
+}
+
+// Matches the character class starting at pattern[p] (the '['), returns false if the class is not terminated
+static bool match_class(const std::string &pattern, size_t &p, char c, bool &matched) {
+    auto i = p + 1;
+    auto negate = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negate) {
+        i++;
+    }
+
+    matched = false;
+    auto first = true;
+    for (; i < pattern.size(); i++) {
+        // A ] directly after the opening bracket is part of the class
+        if (pattern[i] == ']' && !first) {
+            p = i + 1;
+            matched = matched != negate;
+            return true;
+        }
+        first = false;
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            if (pattern[i] <= c && c <= pattern[i + 2]) {
+                matched = true;
+            }
+            i += 2;
+        } else if (pattern[i] == c) {
+            matched = true;
+        }
+    }
+    return false;
+}
+
+bool match_component(const std::string &pattern, const std::string &name) {
+    size_t p = 0, n = 0;
+    // Position to backtrack to after the last *
+    auto star = std::string::npos;
+    size_t star_n = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size()) {
+            auto c = pattern[p];
+            if (c == '*') {
+                star = p++;
+                star_n = n;
+                continue;
+            }
+            if (c == '?') {
+                p++;
+                n++;
+                continue;
+            }
+            if (c == '[') {
+                auto next = p;
+                bool matched = false;
+                if (match_class(pattern, next, name[n], matched)) {
+                    if (matched) {
+                        p = next;
+                        n++;
+                        continue;
+                    }
+                } else if (name[n] == '[') {
+                    p++;
+                    n++;
+                    continue;
+                }
+            } else if (c == name[n]) {
+                p++;
+                n++;
+                continue;
+            }
+        }
+        if (star == std::string::npos) {
+            return false;
+        }
+        p = star + 1;
+        n = ++star_n;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+static std::vector<std::string> split_path(const std::string &path) {
+    std::vector<std::string> parts;
+    auto generic = fs::path(path).generic_string();
+    size_t start = 0;
+    while (start <= generic.size()) {
+        auto slash = generic.find('/', start);
+        if (slash == std::string::npos) {
+            slash = generic.size();
+        }
+        auto part = generic.substr(start, slash - start);
+        if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = slash + 1;
+    }
+    return parts;
+}
+
+std::vector<Matcher::Pattern> Matcher::compile(const std::string &pattern, size_t source) {
+    std::vector<Pattern> result;
+    for (const auto &expanded : expand_braces(pattern)) {
+        Pattern compiled;
+        compiled.source = source;
+
+        auto parts = split_path(expanded);
+        for (size_t i = 0; i < parts.size(); i++) {
+            const auto &part = parts[i];
+            Component component;
+            if (part == "**") {
+                component.recursive = true;
+            } else if (i + 1 == parts.size() && part.compare(0, 2, "**") == 0) {
+                // Legacy syntax: dir/**.ext is dir/**/*.ext
+                component.recursive = true;
+                compiled.components.push_back(component);
+                component = Component();
+                component.text = part.substr(1);
+            } else {
+                component.text = part;
+                component.literal = part.find_first_of("*?[") == std::string::npos;
+            }
+            compiled.components.push_back(component);
+        }
+
+        // A trailing ** matches all the files in the tree
+        if (compiled.components.empty() || compiled.components.back().recursive) {
+            compiled.subtree = !compiled.components.empty();
+            Component component;
+            component.text = "*";
+            compiled.components.push_back(component);
+        }
+        result.push_back(compiled);
+    }
+    return result;
+}
+
+// Matches path components against pattern components, ** matches any number of them
+static bool match_path(const std::vector<Matcher::Component> &components, size_t c, size_t end, const std::vector<std::string> &parts,
+                       size_t p) {
+    if (c == end) {
+        return p == parts.size();
+    }
+    const auto &component = components[c];
+    if (component.recursive) {
+        for (auto i = p; i <= parts.size(); i++) {
+            if (match_path(components, c + 1, end, parts, i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (p == parts.size()) {
+        return false;
+    }
+    if (component.literal ? component.text != parts[p] : !match_component(component.text, parts[p])) {
+        return false;
+    }
+    return match_path(components, c + 1, end, parts, p + 1);
+}
+
+size_t Matcher::add(const std::string &pattern) {
+    auto source = m_sources++;
+    for (const auto &compiled : compile(pattern, source)) {
+        m_patterns.push_back(compiled);
+    }
+    return source;
+}
+
+void Matcher::exclude(const std::string &pattern) {
+    for (const auto &compiled : compile(pattern, 0)) {
+        m_excludes.push_back(compiled);
+    }
+}
+
+void Matcher::ignore_files(const std::vector<std::string> &names) {
+    m_ignore_files = names;
+}
+
+bool Matcher::excluded(const std::vector<std::string> &parts) const {
+    for (const auto &exclude : m_excludes) {
+        if (match_path(exclude.components, 0, exclude.components.size(), parts, 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Matcher::excluded(const fs::path &path) const {
+    return !m_excludes.empty() && excluded(split_path(path.string()));
+}
+
+bool Matcher::pruned(const std::vector<std::string> &parts) const {
+    for (const auto &exclude : m_excludes) {
+        // Only dir/** excludes everything below a directory, the trailing * is implicit
+        if (exclude.subtree && match_path(exclude.components, 0, exclude.components.size() - 1, parts, 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Matcher::starts_recursive(size_t source) const {
+    for (const auto &pattern : m_patterns) {
+        if (pattern.source == source && pattern.components.front().recursive) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+struct State {
+    size_t pattern;
+    size_t component;
+
+    bool operator==(const State &other) const {
+        return pattern == other.pattern && component == other.component;
+    }
+};
+
+void add_state(std::vector<State> &states, const State &state) {
+    for (const auto &existing : states) {
+        if (existing == state) {
+            return;
+        }
+    }
+    states.push_back(state);
+}
+
+fs::path join(const fs::path &root, const fs::path &relative) {
+    return relative.empty() ? root : root / relative;
+}
+
+// Rules of a single ignore file (a subset of the .gitignore syntax)
+struct IgnoreList {
+    struct Rule {
+        std::vector<Matcher::Component> components;
+        bool negate = false;
+        bool directory_only = false;
+    };
+
+    std::shared_ptr<const IgnoreList> parent;
+    // Number of path components of the directory containing the ignore file
+    size_t depth = 0;
+    std::vector<Rule> rules;
+
+    static std::shared_ptr<IgnoreList> parse(const fs::path &file) {
+        std::shared_ptr<IgnoreList> list(new IgnoreList);
+        std::ifstream ifs(file, std::ios::binary);
+        std::string line;
+        while (std::getline(ifs, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+                line.pop_back();
+            }
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            Rule rule;
+            if (line[0] == '!') {
+                rule.negate = true;
+                line.erase(0, 1);
+            } else if (line[0] == '\\') {
+                line.erase(0, 1);
+            }
+            if (!line.empty() && line.back() == '/') {
+                rule.directory_only = true;
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+
+            // Patterns without a slash match at any depth
+            if (line.find('/') == std::string::npos) {
+                Matcher::Component component;
+                component.recursive = true;
+                rule.components.push_back(component);
+            }
+            for (const auto &part : split_path(line)) {
+                Matcher::Component component;
+                component.recursive = part == "**";
+                component.text = part;
+                component.literal = part.find_first_of("*?[") == std::string::npos;
+                rule.components.push_back(component);
+            }
+            list->rules.push_back(rule);
+        }
+        return list;
+    }
+
+    // The deepest ignore file and the last matching rule take precedence
+    static bool ignored(const IgnoreList *list, const std::vector<std::string> &parts, bool is_directory) {
+        for (; list != nullptr; list = list->parent.get()) {
+            std::vector<std::string> relative(parts.begin() + static_cast<std::ptrdiff_t>(list->depth), parts.end());
+            for (auto rule = list->rules.rbegin(); rule != list->rules.rend(); ++rule) {
+                if (rule->directory_only && !is_directory) {
+                    continue;
+                }
+                if (match_path(rule->components, 0, rule->components.size(), relative, 0)) {
+                    return !rule->negate;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+struct Node {
+    fs::path relative;
+    std::vector<std::string> parts;
+    // Only resolved through symbolic links, the other directories append their name
+    fs::path canonical;
+    std::shared_ptr<const Node> parent;
+    std::vector<State> states;
+    // Reached through a symbolic link
+    bool resolve = false;
+    std::shared_ptr<const IgnoreList> ignores;
+
+    bool has_ancestor(const fs::path &path) const {
+        for (auto node = this; node != nullptr; node = node->parent.get()) {
+            if (node->canonical == path) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+} // namespace
+
+Matcher::Result Matcher::expand(dircache::DirectoryCache &directories, pool::ThreadPool &pool, const fs::path &root) const {
+    Result result;
+    result.matches.resize(m_sources);
+
+    // The directory before the first wildcard has to exist
+    for (const auto &pattern : m_patterns) {
+        fs::path base;
+        for (size_t i = 0; i + 1 < pattern.components.size() && pattern.components[i].literal; i++) {
+            base /= pattern.components[i].text;
+        }
+        if (!directories.list(join(root, base))->exists) {
+            throw std::runtime_error("Directory does not exist: " + base.string());
+        }
+    }
+
+    std::mutex mutex;
+    pool::TaskGroup group(pool);
+    std::function<void(std::shared_ptr<const Node>)> visit = [&](std::shared_ptr<const Node> node) {
+        auto snapshot = directories.list(join(root, node->relative));
+        if (!snapshot->exists) {
+            return;
+        }
+
+        // A ** also matches zero directories
+        std::vector<State> states;
+        for (auto state : node->states) {
+            add_state(states, state);
+            while (m_patterns[state.pattern].components[state.component].recursive) {
+                state.component++;
+                add_state(states, state);
+            }
+        }
+
+        // Ignore files apply to the directory they are in
+        auto ignores = node->ignores;
+        std::vector<fs::path> ignore_files;
+        for (const auto &name : m_ignore_files) {
+            for (const auto &entry : snapshot->entries) {
+                if (!entry.is_directory && entry.name == name) {
+                    auto list = IgnoreList::parse(join(root, node->relative) / name);
+                    list->parent = ignores;
+                    list->depth = node->parts.size();
+                    ignores = list;
+                    ignore_files.push_back(node->relative / name);
+                }
+            }
+        }
+
+        std::vector<std::pair<size_t, fs::path>> matches;
+        auto parts = node->parts;
+        for (const auto &entry : snapshot->entries) {
+            // Git never descends into its own directory
+            if (!m_ignore_files.empty() && entry.is_directory && entry.name == ".git") {
+                continue;
+            }
+            if (ignores || !m_excludes.empty()) {
+                parts.push_back(entry.name);
+                auto skip = IgnoreList::ignored(ignores.get(), parts, entry.is_directory) ||
+                            (entry.is_directory ? pruned(parts) : excluded(parts));
+                parts.pop_back();
+                if (skip) {
+                    continue;
+                }
+            }
+
+            std::vector<State> child_states;
+            for (const auto &state : states) {
+                const auto &pattern = m_patterns[state.pattern];
+                const auto &component = pattern.components[state.component];
+                if (component.recursive) {
+                    if (entry.is_directory) {
+                        add_state(child_states, state);
+                    }
+                    continue;
+                }
+                if (component.literal ? component.text != entry.name : !match_component(component.text, entry.name)) {
+                    continue;
+                }
+                if (state.component + 1 == pattern.components.size()) {
+                    if (!entry.is_directory) {
+                        auto path = node->relative / entry.name;
+                        if (node->resolve || entry.is_symlink) {
+                            path = fs::relative(root / path, root);
+                        }
+                        matches.emplace_back(pattern.source, std::move(path));
+                    }
+                } else if (entry.is_directory) {
+                    add_state(child_states, State{state.pattern, state.component + 1});
+                }
+            }
+            if (child_states.empty()) {
+                continue;
+            }
+
+            std::shared_ptr<Node> child(new Node);
+            child->relative = node->relative / entry.name;
+            child->parts = node->parts;
+            child->parts.push_back(entry.name);
+            if (entry.is_symlink) {
+                // Do not follow symbolic links that point to a directory on the current path
+                std::error_code ec;
+                child->canonical = fs::canonical(root / child->relative, ec);
+                if (ec || node->has_ancestor(child->canonical)) {
+                    continue;
+                }
+            } else {
+                child->canonical = node->canonical / entry.name;
+            }
+            child->parent = node;
+            child->states = std::move(child_states);
+            child->resolve = node->resolve || entry.is_symlink;
+            child->ignores = ignores;
+
+            group.run([&visit, child]() {
+                visit(child);
+            });
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        result.directories.push_back(node->relative);
+        for (auto &file : ignore_files) {
+            result.ignore_files.push_back(std::move(file));
+        }
+        for (auto &match : matches) {
+            result.matches[match.first].push_back(std::move(match.second));
+        }
+    };
+
+    std::error_code ec;
+    std::shared_ptr<Node> node(new Node);
+    node->canonical = fs::canonical(root, ec);
+    if (ec) {
+        throw std::runtime_error("Directory does not exist: " + root.string());
+    }
+    for (size_t i = 0; i < m_patterns.size(); i++) {
+        node->states.push_back(State{i, 0});
+    }
+    visit(node);
+    group.wait();
+
+    // Tasks finish in any order
+    std::sort(result.directories.begin(), result.directories.end());
+    std::sort(result.ignore_files.begin(), result.ignore_files.end());
+    for (auto &matches : result.matches) {
+        std::sort(matches.begin(), matches.end());
+    }
+    return result;
+}
+
+} // namespace glob
+} // namespace cmkr
@@ -13,8 +13,16 @@ const char *message() noexcept {
 Usage: cmkr [arguments]
 arguments:
     init    [executable|library|shared|static|interface] Starts a new project in the same directory.
-    gen                                                  Generates CMakeLists.txt file.
-    build   <extra cmake args>                           Run cmake and build.
+    gen     [-j <jobs>] [--cache-dir <dir>]              Generates CMakeLists.txt file (jobs defaults to the thread count).
+                                                         The cache directory enables incremental generation.
+                                                         --stats prints the directory reads and stat calls saved.
+                                                         --trace <file> writes a Chrome trace of the phases and
+                                                         prints the slowest directories and targets.
+    watch   [-j <jobs>] [--stats]                        Generates CMakeLists.txt files and regenerates them when a
+                                                         cmake.toml or a globbed directory changes (Linux only).
+    build   [--pgo] <extra cmake args>                   Run cmake and build. --pgo builds the instrumented targets,
+                                                         runs the [[pgo-training]] and builds the optimized targets.
+                                                         Prints the cache hits of the [cmake].compiler-launcher.
     install                                              Run cmake --install. Needs admin privileges.
     clean                                                Clean the build directory.
     help                                                 Show help.
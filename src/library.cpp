@@ -0,0 +1,65 @@
+#include "library.hpp"
+
+#include "fs.hpp"
+#include "project_parser.hpp"
+#include "toml_parser.hpp"
+
+#include <exception>
+#include <mutex>
+
+namespace cmkr {
+namespace lib {
+
+static std::mutex generate_mutex;
+
+static Result run(const std::string &path, const std::string *toml, const Options &options) {
+    std::lock_guard<std::mutex> lock(generate_mutex);
+    Result result;
+    diag::Collector collector;
+    diag::Diagnostic error;
+
+    // Every generation reads the cmake.toml files again
+    parser::clear_documents();
+    try {
+        if (toml != nullptr) {
+            parser::set_toml(path, *toml);
+        }
+        auto generator = options.generator;
+        generator.write = options.write;
+        generator.outputs = &result.files;
+        gen::generate_cmake(path.c_str(), generator);
+        result.success = true;
+    } catch (const diag::Error &e) {
+        error = e.diagnostic();
+    } catch (const std::exception &e) {
+        error = diag::Diagnostic(diag::severity_error, e.what());
+        parser::toml_error_location(e, error);
+    }
+    parser::clear_documents();
+
+    result.diagnostics = collector.take();
+    if (result.success) {
+        auto cmakelists = (fs::path(path) / "CMakeLists.txt").string();
+        for (const auto &file : result.files) {
+            if (file.path == cmakelists) {
+                result.cmakelists = file.contents;
+                break;
+            }
+        }
+    } else {
+        result.files.clear();
+        result.diagnostics.push_back(error);
+    }
+    return result;
+}
+
+Result generate(const std::string &path, const Options &options) {
+    return run(path, nullptr, options);
+}
+
+Result generate_toml(const std::string &path, const std::string &toml, const Options &options) {
+    return run(path, &toml, options);
+}
+
+} // namespace lib
+} // namespace cmkr
@@ -0,0 +1,330 @@
+#include "manifest.hpp"
+#include "files.hpp"
+#include "help.hpp"
+#include "project_parser.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+namespace cmkr {
+namespace manifest {
+
+uint64_t hash(const char *data, size_t size, uint64_t seed) {
+    auto h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static std::string to_hex(uint64_t h) {
+    char buffer[17];
+    (void)snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(h));
+    return buffer;
+}
+
+std::string hash_string(const std::string &data) {
+    return to_hex(hash(data.data(), data.size()));
+}
+
+std::string hash_file(const fs::path &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return "-";
+    }
+    auto h = hash(nullptr, 0);
+    char buffer[16 * 1024];
+    while (ifs) {
+        ifs.read(buffer, sizeof(buffer));
+        h = hash(buffer, static_cast<size_t>(ifs.gcount()), h);
+    }
+    return to_hex(h);
+}
+
+std::string hash_listing(dircache::DirectoryCache &directories, const fs::path &directory) {
+    auto snapshot = directories.list(directory);
+    if (!snapshot->exists) {
+        return "-";
+    }
+    // The entries are sorted by name
+    auto h = hash(nullptr, 0);
+    for (const auto &entry : snapshot->entries) {
+        // Include the terminator to separate the names
+        h = hash(entry.name.c_str(), entry.name.size() + 1, h);
+        h = hash(entry.is_directory ? "/" : "", 1, h);
+        if (entry.is_symlink) {
+            // The target of a link can be (re)moved without changing this directory
+            std::error_code ec;
+            auto status = fs::status(directory / entry.name, ec);
+            auto type = fs::is_directory(status) ? "d" : fs::exists(status) ? "f" : "-";
+            h = hash(type, 1, h);
+        }
+    }
+    return to_hex(h);
+}
+
+void Directory::add_listing(dircache::DirectoryCache &directories, const fs::path &root, const fs::path &directory) {
+    auto key = directory.lexically_normal().generic_string();
+    if (key.empty()) {
+        key = ".";
+    }
+    if (!listings.contains(key)) {
+        listings.emplace(key, hash_listing(directories, root / key));
+    }
+}
+
+void Directory::add_input(const fs::path &root, const fs::path &file) {
+    auto key = file.lexically_normal().generic_string();
+    inputs[key] = hash_file(root / key);
+}
+
+void Directory::add_output(const fs::path &root, const fs::path &file) {
+    auto key = file.lexically_normal().generic_string();
+    outputs[key] = hash_file(root / key);
+}
+
+static std::string cached_hash(dircache::DirectoryCache &directories, const fs::path &file) {
+    std::string hash;
+    if (!directories.file_hash(file, hash)) {
+        hash = hash_file(file);
+        directories.set_file_hash(file, hash);
+    }
+    return hash;
+}
+
+bool Directory::up_to_date(dircache::DirectoryCache &directories, const fs::path &root) const {
+    if (parser::toml_hash(root.string()) != toml) {
+        return false;
+    }
+    for (const auto &itr : inputs) {
+        if (cached_hash(directories, root / itr.first) != itr.second) {
+            return false;
+        }
+    }
+    for (const auto &itr : outputs) {
+        if (cached_hash(directories, root / itr.first) != itr.second) {
+            return false;
+        }
+    }
+    for (const auto &itr : listings) {
+        if (hash_listing(directories, root / itr.first) != itr.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string Manifest::subdir_key(const std::string &parent, const fs::path &sub) {
+    auto generic = sub.lexically_normal().generic_string();
+    if (parent == ".") {
+        return generic;
+    }
+    return parent + "/" + generic;
+}
+
+std::string Manifest::subdir_scope(const std::string &parent_scope, const std::string &parent_toml) {
+    return hash_string(parent_scope + ":" + parent_toml);
+}
+
+bool Manifest::load(const fs::path &file) {
+    m_directories.clear();
+    m_up_to_date.clear();
+    m_directory_up_to_date.clear();
+
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    auto split = [](const std::string &line, std::string &value, std::string &rest) {
+        auto space = line.find(' ');
+        if (space == std::string::npos) {
+            value = line;
+            rest.clear();
+        } else {
+            value = line.substr(0, space);
+            rest = line.substr(space + 1);
+        }
+    };
+
+    std::string line;
+    if (!std::getline(ifs, line) || line != "cmkr-manifest 1") {
+        return false;
+    }
+    if (!std::getline(ifs, line) || line != std::string("version ") + help::version()) {
+        return false;
+    }
+
+    Directory *directory = nullptr;
+    while (std::getline(ifs, line)) {
+        std::string type, rest, value, path;
+        split(line, type, rest);
+        if (type == "directory") {
+            directory = &m_directories[rest];
+            continue;
+        }
+        if (directory == nullptr) {
+            return false;
+        }
+        if (type == "scope") {
+            directory->scope = rest;
+        } else if (type == "toml") {
+            directory->toml = rest;
+        } else if (type == "listing") {
+            split(rest, value, path);
+            directory->listings[path] = value;
+        } else if (type == "input") {
+            split(rest, value, path);
+            directory->inputs[path] = value;
+        } else if (type == "output") {
+            split(rest, value, path);
+            directory->outputs[path] = value;
+        } else if (type == "subdir") {
+            Subdir subdir;
+            split(rest, subdir.toml, rest);
+            split(rest, value, subdir.key);
+            subdir.generated = value == "1";
+            directory->subdirs.push_back(subdir);
+        } else {
+            m_directories.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void Manifest::save(const fs::path &file) const {
+    std::ostringstream oss;
+    oss << "cmkr-manifest 1\n";
+    oss << "version " << help::version() << '\n';
+    for (const auto &itr : m_directories) {
+        const auto &directory = itr.second;
+        oss << "directory " << itr.first << '\n';
+        oss << "scope " << directory.scope << '\n';
+        oss << "toml " << directory.toml << '\n';
+        for (const auto &jtr : directory.listings) {
+            oss << "listing " << jtr.second << ' ' << jtr.first << '\n';
+        }
+        for (const auto &jtr : directory.inputs) {
+            oss << "input " << jtr.second << ' ' << jtr.first << '\n';
+        }
+        for (const auto &jtr : directory.outputs) {
+            oss << "output " << jtr.second << ' ' << jtr.first << '\n';
+        }
+        for (const auto &subdir : directory.subdirs) {
+            oss << "subdir " << (subdir.toml.empty() ? "-" : subdir.toml) << ' ' << (subdir.generated ? '1' : '0') << ' ' << subdir.key << '\n';
+        }
+    }
+
+    files::update(file, oss.str());
+}
+
+const Directory *Manifest::find(const std::string &key) const {
+    auto itr = m_directories.find(key);
+    if (itr == m_directories.end()) {
+        return nullptr;
+    }
+    return &itr->second;
+}
+
+void Manifest::insert(const std::string &key, const Directory &directory) {
+    m_directories[key] = directory;
+}
+
+void Manifest::copy_tree(const Manifest &other, const std::string &key) {
+    auto directory = other.find(key);
+    if (directory == nullptr) {
+        return;
+    }
+    insert(key, *directory);
+    for (const auto &subdir : directory->subdirs) {
+        if (subdir.generated) {
+            copy_tree(other, subdir.key);
+        }
+    }
+}
+
+// The subdirectory is a direct child, so its cmake.toml decides if it is generated
+static bool direct_subdir(const std::string &parent, const std::string &key) {
+    auto relative = parent == "." ? key : key.substr(parent.size() + 1);
+    while (!relative.empty() && relative.back() == '/') {
+        relative.pop_back();
+    }
+    return !relative.empty() && relative != "." && relative != ".." && relative.find('/') == std::string::npos;
+}
+
+// The parent generates a subdirectory with a cmake.toml that has no [project]
+static bool still_generated(const fs::path &path) {
+    if (parser::toml_hash(path.string()) == "-") {
+        return false;
+    }
+    try {
+        return !parser::is_root_path(path.string());
+    } catch (const std::exception &) {
+        // Generating the parent again reports the error
+        return false;
+    }
+}
+
+void Manifest::validate(dircache::DirectoryCache &directories, const fs::path &root_path) {
+    m_up_to_date.clear();
+    m_directory_up_to_date.clear();
+
+    // Post-order traversal, a tree is only up-to-date if all of its subdirectories are
+    std::function<bool(const std::string &)> validate_tree = [&](const std::string &key) {
+        auto found = m_up_to_date.find(key);
+        if (found != m_up_to_date.end()) {
+            return found->second;
+        }
+        // Insert first to guard against cycles in a corrupted manifest
+        m_up_to_date[key] = false;
+
+        auto directory = find(key);
+        if (directory == nullptr) {
+            return false;
+        }
+        auto directory_up_to_date = directory->up_to_date(directories, root_path / key);
+        auto up_to_date = directory_up_to_date;
+        for (const auto &subdir : directory->subdirs) {
+            // Keep validating the other subdirectories, they can be skipped even
+            // if this directory (or one of their siblings) is generated again
+            if (subdir.generated) {
+                up_to_date = validate_tree(subdir.key) && up_to_date;
+                directory_up_to_date = directory_up_to_date && still_generated(root_path / subdir.key);
+            } else {
+                auto unchanged = parser::toml_hash((root_path / subdir.key).string()) == subdir.toml;
+                up_to_date = up_to_date && unchanged;
+                directory_up_to_date = directory_up_to_date && unchanged;
+            }
+            // The cmake.toml files of the directories in between are not recorded
+            directory_up_to_date = directory_up_to_date && direct_subdir(key, subdir.key);
+        }
+        m_up_to_date[key] = up_to_date;
+        m_directory_up_to_date[key] = directory_up_to_date;
+        return up_to_date;
+    };
+    validate_tree(".");
+}
+
+bool Manifest::tree_up_to_date(const std::string &key, const std::string &scope) const {
+    auto found = m_up_to_date.find(key);
+    if (found == m_up_to_date.end() || !found->second) {
+        return false;
+    }
+    return find(key)->scope == scope;
+}
+
+bool Manifest::directory_up_to_date(const std::string &key, const std::string &scope) const {
+    auto found = m_directory_up_to_date.find(key);
+    if (found == m_directory_up_to_date.end() || !found->second) {
+        return false;
+    }
+    return find(key)->scope == scope;
+}
+
+} // namespace manifest
+} // namespace cmkr
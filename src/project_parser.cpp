@@ -1,13 +1,85 @@
 #include "project_parser.hpp"
 
+#include "diagnostics.hpp"
+#include "files.hpp"
 #include "fs.hpp"
+#include "manifest.hpp"
+#include "toml_parser.hpp"
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
-#include <toml.hpp>
+#include <unordered_map>
 
 namespace cmkr {
 namespace parser {
 
+// A cmake.toml file, shared between cmkr build, the generator and the subdirectory checks
+struct Document {
+    std::mutex mutex;
+    std::string hash;
+    // Released once parsed
+    std::string contents;
+    std::unique_ptr<TomlBasicValue> toml;
+};
+
+static std::mutex documents_mutex;
+static tsl::ordered_map<std::string, std::shared_ptr<Document>> documents;
+
+// Returns nullptr if the file does not exist
+static std::shared_ptr<Document> load_document(const fs::path &toml_path) {
+    auto key = fs::absolute(toml_path).lexically_normal().generic_string();
+    {
+        std::lock_guard<std::mutex> lock(documents_mutex);
+        auto itr = documents.find(key);
+        if (itr != documents.end()) {
+            return itr->second;
+        }
+    }
+
+    // Missing files are not remembered, they can still be created (cmkr init)
+    std::shared_ptr<Document> document(new Document);
+    if (!files::try_read(toml_path, document->contents)) {
+        return nullptr;
+    }
+    document->hash = manifest::hash_string(document->contents);
+
+    std::lock_guard<std::mutex> lock(documents_mutex);
+    return documents.emplace(key, document).first->second;
+}
+
+void set_toml(const std::string &path, const std::string &contents) {
+    std::shared_ptr<Document> document(new Document);
+    document->contents = contents;
+    document->hash = manifest::hash_string(contents);
+
+    auto key = fs::absolute(fs::path(path) / "cmake.toml").lexically_normal().generic_string();
+    std::lock_guard<std::mutex> lock(documents_mutex);
+    documents[key] = document;
+}
+
+void forget_toml(const std::string &path) {
+    auto key = fs::absolute(fs::path(path) / "cmake.toml").lexically_normal().generic_string();
+    std::lock_guard<std::mutex> lock(documents_mutex);
+    documents.erase(key);
+}
+
+void clear_documents() {
+    std::lock_guard<std::mutex> lock(documents_mutex);
+    documents.clear();
+}
+
+static const TomlBasicValue &parse_document(Document &document, const fs::path &toml_path) {
+    std::lock_guard<std::mutex> lock(document.mutex);
+    if (!document.toml) {
+        std::istringstream iss(document.contents);
+        document.toml.reset(new TomlBasicValue(parse_toml(iss, toml_path.string())));
+        std::string().swap(document.contents);
+    }
+    return *document.toml;
+}
+
 const char *targetTypeNames[target_last] = {"executable", "library", "shared", "static", "interface", "custom", "object", "template"};
 
 static TargetType parse_targetType(const std::string &name) {
@@ -21,6 +93,39 @@ static TargetType parse_targetType(const std::string &name) {
 
 const char *msvcRuntimeTypeNames[msvc_last] = {"dynamic", "static"};
 
+const char *unityModeNames[unity_last] = {"batch", "group"};
+
+static UnityMode parse_unityMode(const std::string &name) {
+    for (int i = 0; i < unity_last; i++) {
+        if (name == unityModeNames[i]) {
+            return static_cast<UnityMode>(i);
+        }
+    }
+    return unity_last;
+}
+
+const char *ltoModeNames[lto_last] = {"off", "full", "thin"};
+
+LtoMode parse_ltoMode(const std::string &name) {
+    for (int i = 0; i < lto_last; i++) {
+        if (name == ltoModeNames[i]) {
+            return static_cast<LtoMode>(i);
+        }
+    }
+    return lto_last;
+}
+
+const char *compilerLauncherNames[launcher_last] = {"none", "auto", "ccache", "sccache"};
+
+static CompilerLauncher parse_compilerLauncher(const std::string &name) {
+    for (int i = 0; i < launcher_last; i++) {
+        if (name == compilerLauncherNames[i]) {
+            return static_cast<CompilerLauncher>(i);
+        }
+    }
+    return launcher_last;
+}
+
 static MsvcRuntimeType parse_msvcRuntimeType(const std::string &name) {
     for (int i = 0; i < msvc_last; i++) {
         if (name == msvcRuntimeTypeNames[i]) {
@@ -30,8 +135,6 @@ static MsvcRuntimeType parse_msvcRuntimeType(const std::string &name) {
     return msvc_last;
 }
 
-using TomlBasicValue = toml::basic_value<toml::discard_comments, tsl::ordered_map, std::vector>;
-
 static std::string format_key_message(const std::string &message, const toml::key &ky, const TomlBasicValue &value) {
     auto loc = value.location();
     auto line_number_str = std::to_string(loc.line());
@@ -57,47 +160,167 @@ static std::string format_key_message(const std::string &message, const toml::ke
     return oss.str();
 }
 
+static diag::Diagnostic key_diagnostic(diag::Severity severity, const std::string &text, const toml::key &ky, const TomlBasicValue &value) {
+    diag::Diagnostic diagnostic(severity, format_key_message(text, ky, value));
+    auto loc = value.location();
+    diagnostic.file = loc.file_name();
+    diagnostic.line = loc.line();
+    diagnostic.column = loc.column();
+    return diagnostic;
+}
+
 static void throw_key_error(const std::string &error, const toml::key &ky, const TomlBasicValue &value) {
-    throw std::runtime_error(format_key_message("[error] " + error, ky, value));
+    throw diag::Error(key_diagnostic(diag::severity_error, "[error] " + error, ky, value));
+}
+
+static std::string unknown_lto_error(const std::string &mode) {
+    std::string error = "Unknown lto mode '" + mode + "'\n";
+    error += "Available modes:\n";
+    for (std::string mode_name : ltoModeNames) {
+        error += "  - " + mode_name + "\n";
+    }
+    error.pop_back(); // Remove last newline
+    return error;
+}
+
+// The lto and pgo keys generate target_link_options (CMake 3.13)
+static void check_link_options_version(const Project &project, const toml::key &ky, const TomlBasicValue &value) {
+    if (!project.cmake_minimum_version(3, 13)) {
+        throw_key_error(ky + " is only supported on CMake version 3.13 and above.\nSet the CMake version in cmake.toml:\n"
+                        "[cmake]\n"
+                        "version = \"3.13\"\n",
+                        ky, value);
+    }
 }
 
 static void print_key_warning(const std::string &message, const toml::key &ky, const TomlBasicValue &value) {
-    puts(format_key_message("[warning] " + message, ky, value).c_str());
+    diag::warning(key_diagnostic(diag::severity_warning, "[warning] " + message, ky, value));
 }
 
+// Index of the keys of a table and its condition sub-tables, built in a single pass. The
+// keys point into the parsed document, so building the index only allocates one vector.
+class TomlKeyIndex {
+  public:
+    struct Entry {
+        const toml::key *key = nullptr;
+        // Position of the key (or of the condition sub-table containing it) in the table
+        size_t position = 0;
+        // Not set for the key of a sub-table itself
+        const TomlBasicValue *value = nullptr;
+        bool conditional = false;
+        // Shared by all the entries of the same key, used to index the visited bitset
+        size_t id = 0;
+    };
+
+  private:
+    // Sorted by key, entries of the same key are ordered by position
+    std::vector<Entry> m_entries;
+
+    struct Compare {
+        bool operator()(const Entry &entry, const toml::key &ky) const {
+            return *entry.key < ky;
+        }
+        bool operator()(const toml::key &ky, const Entry &entry) const {
+            return ky < *entry.key;
+        }
+    };
+
+  public:
+    explicit TomlKeyIndex(const TomlBasicValue &table) {
+        const auto &entries = table.as_table();
+        size_t count = entries.size();
+        for (const auto &itr : entries) {
+            if (itr.second.is_table()) {
+                count += itr.second.as_table().size();
+            }
+        }
+        m_entries.reserve(count);
+
+        size_t position = 0;
+        for (const auto &itr : entries) {
+            Entry entry;
+            entry.key = &itr.first;
+            entry.position = position;
+            if (itr.second.is_table()) {
+                // The key of the sub-table itself can be visited as well
+                m_entries.push_back(entry);
+                entry.conditional = true;
+                for (const auto &jtr : itr.second.as_table()) {
+                    entry.key = &jtr.first;
+                    entry.value = &jtr.second;
+                    m_entries.push_back(entry);
+                }
+            } else {
+                entry.value = &itr.second;
+                m_entries.push_back(entry);
+            }
+            position++;
+        }
+
+        std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+            return *a.key < *b.key;
+        });
+        for (size_t i = 0; i < m_entries.size(); i++) {
+            m_entries[i].id = i > 0 && *m_entries[i - 1].key == *m_entries[i].key ? m_entries[i - 1].id : i;
+        }
+    }
+
+    // All the entries of a key, empty if it does not appear in the table or its sub-tables
+    std::pair<const Entry *, const Entry *> lookup(const toml::key &ky) const {
+        auto range = std::equal_range(m_entries.begin(), m_entries.end(), ky, Compare());
+        return std::make_pair(m_entries.data() + (range.first - m_entries.begin()), m_entries.data() + (range.second - m_entries.begin()));
+    }
+
+    size_t size() const {
+        return m_entries.size();
+    }
+};
+
 class TomlChecker {
     const TomlBasicValue &m_v;
-    tsl::ordered_set<toml::key> m_visited;
-    tsl::ordered_set<toml::key> m_conditionVisited;
+    std::unique_ptr<TomlKeyIndex> m_index;
+    // Indexed by key id, only keys that appear in the table are tracked
+    std::vector<bool> m_visited;
+    // Indexed by position in the table
+    std::vector<bool> m_conditionVisited;
+
+    const TomlKeyIndex &index() {
+        if (!m_index) {
+            m_index.reset(new TomlKeyIndex(m_v));
+            m_visited.resize(m_index->size());
+            m_conditionVisited.resize(m_v.as_table().size());
+        }
+        return *m_index;
+    }
 
   public:
     TomlChecker(const TomlBasicValue &v, const toml::key &ky) : m_v(toml::find(v, ky)) {
+        if (m_v.is_table()) {
+            index();
+        }
     }
     explicit TomlChecker(const TomlBasicValue &v) : m_v(v) {
+        if (m_v.is_table()) {
+            index();
+        }
     }
     TomlChecker(const TomlChecker &) = delete;
     TomlChecker(TomlChecker &&) = delete;
 
     template <typename T>
     void optional(const toml::key &ky, Condition<T> &destination) {
-        // TODO: this algorithm in O(n) over the amount of keys, kinda bad
+        const auto entries = index().lookup(ky);
         const auto &table = m_v.as_table();
-        for (const auto &itr : table) {
-            const auto &key = itr.first;
-            const auto &value = itr.second;
-            if (value.is_table()) {
-                if (value.contains(ky)) {
-                    destination[key] = toml::find<T>(value, ky);
-                }
-            } else if (key == ky) {
-                destination[""] = toml::find<T>(m_v, ky);
+        for (auto entry = entries.first; entry != entries.second; ++entry) {
+            if (entry->value == nullptr) {
+                continue;
             }
-        }
-
-        // Handle visiting logic
-        for (const auto &itr : destination) {
-            if (!itr.first.empty()) {
-                m_conditionVisited.emplace(itr.first);
+            if (entry->conditional) {
+                const auto &condition = table.nth(entry->position)->first;
+                destination[condition] = toml::get<T>(*entry->value);
+                m_conditionVisited[entry->position] = true;
+            } else {
+                destination[""] = toml::get<T>(*entry->value);
             }
         }
         visit(ky);
@@ -129,30 +352,39 @@ class TomlChecker {
     }
 
     void visit(const toml::key &ky) {
-        m_visited.emplace(ky);
+        const auto entries = index().lookup(ky);
+        if (entries.first != entries.second) {
+            m_visited[entries.first->id] = true;
+        }
     }
 
-    bool visisted(const toml::key &ky) const {
-        return m_visited.contains(ky);
+    bool visisted(const toml::key &ky) {
+        const auto entries = index().lookup(ky);
+        return entries.first != entries.second && m_visited[entries.first->id];
     }
 
-    void check(const tsl::ordered_map<std::string, std::string> &conditions) const {
+    void check(const Project &project) {
+        index();
+        auto visited = [this](const toml::key &ky) {
+            return m_visited[m_index->lookup(ky).first->id];
+        };
+        size_t position = 0;
         for (const auto &itr : m_v.as_table()) {
             const auto &ky = itr.first;
-            if (m_conditionVisited.contains(ky)) {
-                if (!conditions.contains(ky) && Project::is_condition_name(ky)) {
+            if (m_conditionVisited[position++]) {
+                if (project.find_condition(ky) == nullptr && Project::is_condition_name(ky)) {
                     throw_key_error("Unknown condition '" + ky + "'", ky, itr.second);
                 }
 
                 for (const auto &jtr : itr.second.as_table()) {
-                    if (!m_visited.contains(jtr.first)) {
+                    if (!visited(jtr.first)) {
                         throw_key_error("Unknown key '" + jtr.first + "'", jtr.first, jtr.second);
                     }
                 }
-            } else if (!m_visited.contains(ky)) {
+            } else if (!visited(ky)) {
                 if (itr.second.is_table()) {
                     for (const auto &jtr : itr.second.as_table()) {
-                        if (!m_visited.contains(jtr.first)) {
+                        if (!visited(jtr.first)) {
                             throw_key_error("Unknown key '" + jtr.first + "'", jtr.first, jtr.second);
                         }
                     }
@@ -160,7 +392,7 @@ class TomlChecker {
                 throw_key_error("Unknown key '" + ky + "'", ky, itr.second);
             } else if (ky == "condition") {
                 std::string condition = itr.second.as_string();
-                if (!conditions.contains(condition) && Project::is_condition_name(condition)) {
+                if (project.find_condition(condition) == nullptr && Project::is_condition_name(condition)) {
                     throw_key_error("Unknown condition '" + condition + "'", condition, itr.second);
                 }
             }
@@ -171,18 +403,29 @@ class TomlChecker {
 class TomlCheckerRoot {
     const TomlBasicValue &m_root;
     std::deque<TomlChecker> m_checkers;
-    tsl::ordered_set<toml::key> m_visisted;
+    std::unordered_map<toml::key, size_t> m_positions;
+    // Indexed by position in the root table
+    std::vector<bool> m_visisted;
     bool m_checked = false;
 
   public:
     explicit TomlCheckerRoot(const TomlBasicValue &root) : m_root(root) {
+        size_t position = 0;
+        for (const auto &itr : m_root.as_table()) {
+            m_positions.emplace(itr.first, position++);
+        }
+        m_visisted.resize(position);
     }
     TomlCheckerRoot(const TomlCheckerRoot &) = delete;
     TomlCheckerRoot(TomlCheckerRoot &&) = delete;
 
     bool contains(const toml::key &ky) {
-        m_visisted.emplace(ky);
-        return m_root.contains(ky);
+        auto itr = m_positions.find(ky);
+        if (itr == m_positions.end()) {
+            return false;
+        }
+        m_visisted[itr->second] = true;
+        return true;
     }
 
     TomlChecker &create(const TomlBasicValue &v) {
@@ -195,26 +438,28 @@ class TomlCheckerRoot {
         return m_checkers.back();
     }
 
-    void check(const tsl::ordered_map<std::string, std::string> &conditions, bool check_root) {
+    void check(const Project &project, bool check_root) {
         if (check_root) {
+            size_t position = 0;
             for (const auto &itr : m_root.as_table()) {
-                if (!m_visisted.contains(itr.first)) {
+                if (!m_visisted[position++]) {
                     throw_key_error("Unknown key '" + itr.first + "'", itr.first, itr.second);
                 }
             }
         }
-        for (const auto &checker : m_checkers) {
-            checker.check(conditions);
+        for (auto &checker : m_checkers) {
+            checker.check(project);
         }
     }
 };
 
 Project::Project(const Project *parent, const std::string &path, bool build) : parent(parent) {
     const auto toml_path = fs::path(path) / "cmake.toml";
-    if (!fs::exists(toml_path)) {
+    const auto document = load_document(toml_path);
+    if (!document) {
         throw std::runtime_error("File not found '" + toml_path.string() + "'");
     }
-    const auto toml = toml::parse<toml::discard_comments, tsl::ordered_map, std::vector>(toml_path.string());
+    const auto &toml = parse_document(*document, toml_path);
     if (toml.size() == 0) {
         throw std::runtime_error("Empty TOML '" + toml_path.string() + "'");
     }
@@ -236,6 +481,21 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
         cmake.optional("arguments", gen_args);
         cmake.optional("allow-in-tree", allow_in_tree);
 
+        std::string launcher;
+        cmake.optional("compiler-launcher", launcher);
+        if (!launcher.empty()) {
+            compiler_launcher = parse_compilerLauncher(launcher);
+            if (compiler_launcher == launcher_last) {
+                std::string error = "Unknown compiler-launcher '" + launcher + "'\n";
+                error += "Available launchers:\n";
+                for (std::string launcher_name : compilerLauncherNames) {
+                    error += "  - " + launcher_name + "\n";
+                }
+                error.pop_back(); // Remove last newline
+                throw_key_error(error, launcher, cmake.find("compiler-launcher"));
+            }
+        }
+
         if (cmake.contains("cmkr-include")) {
             const auto &cmkr_include_kv = cmake.find("cmkr-include");
             if (cmkr_include_kv.is_string()) {
@@ -253,7 +513,7 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
 
     // Skip the rest of the parsing when building
     if (build) {
-        checker.check(conditions, false);
+        checker.check(*this, false);
         return;
     }
 
@@ -282,8 +542,8 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
         conditions["xcode"] = R"cmake(XCODE)cmake";
         conditions["wince"] = R"cmake(WINCE)cmake";
     } else {
-        conditions = parent->conditions;
-        templates = parent->templates;
+        // Conditions and templates of the parents are looked up through the parent chain
+        project_glob_ignore_files = parent->project_glob_ignore_files;
     }
 
     if (checker.contains("conditions")) {
@@ -313,6 +573,7 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
         project.optional("include-before", include_before);
         project.optional("include-after", include_after);
         project.optional("subdirs", project_subdirs);
+        project.optional("glob-ignore-files", project_glob_ignore_files);
 
         std::string msvc_runtime;
         project.optional("msvc-runtime", msvc_runtime);
@@ -328,6 +589,16 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
                 throw_key_error(error, msvc_runtime, project.find("msvc-runtime"));
             }
         }
+
+        std::string lto;
+        project.optional("lto", lto);
+        if (!lto.empty()) {
+            project_lto = parse_ltoMode(lto);
+            if (project_lto == lto_last) {
+                throw_key_error(unknown_lto_error(lto), lto, project.find("lto"));
+            }
+            check_link_options_version(*this, "lto", project.find("lto"));
+        }
     }
 
     if (checker.contains("subdir")) {
@@ -445,8 +716,10 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
             options.push_back(o);
 
             // Add a condition matching the option name
-            if (!conditions.emplace(o.name, o.name).second) {
+            if (find_condition(o.name) != nullptr) {
                 print_key_warning("Option '" + o.name + "' would create a condition '" + o.name + "' that already exists", o.name, value);
+            } else {
+                conditions.emplace(o.name, o.name);
             }
 
             // Add an implicit condition for the option
@@ -455,8 +728,10 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
                 ncondition = ncondition.substr(nproject_prefix.size());
             }
             if (!ncondition.empty() && ncondition != o.name) {
-                if (!conditions.emplace(ncondition, o.name).second) {
+                if (find_condition(ncondition) != nullptr) {
                     print_key_warning("Option '" + o.name + "' would create a condition '" + ncondition + "' that already exists", o.name, value);
+                } else {
+                    conditions.emplace(ncondition, o.name);
                 }
             }
         }
@@ -602,13 +877,8 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
             target.type = target_last;
         }
 
-        if (!isTemplate && target.type == target_last) {
-            for (const auto &tmplate : templates) {
-                if (target.type_name == tmplate.outline.name) {
-                    target.type = target_template;
-                    break;
-                }
-            }
+        if (!isTemplate && target.type == target_last && find_template(target.type_name) != nullptr) {
+            target.type = target_template;
         }
 
         if (target.type == target_last) {
@@ -619,10 +889,20 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
                     error += "  - " + type_name + "\n";
                 }
             }
-            if (!isTemplate && !templates.empty()) {
-                error += "Available templates:\n";
-                for (const auto &tmplate : templates) {
-                    error += "  - " + tmplate.outline.name + "\n";
+            if (!isTemplate) {
+                // Outermost project first
+                std::vector<const Project *> scopes;
+                for (const Project *scope = this; scope != nullptr; scope = scope->parent) {
+                    scopes.insert(scopes.begin(), scope);
+                }
+                std::string available;
+                for (const auto scope : scopes) {
+                    for (const auto &tmplate : scope->templates) {
+                        available += "  - " + tmplate.outline.name + "\n";
+                    }
+                }
+                if (!available.empty()) {
+                    error += "Available templates:\n" + available;
                 }
             }
             error.pop_back(); // Remove last newline
@@ -726,6 +1006,87 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
             }
         }
 
+        t.optional("lto", target.lto);
+        for (const auto &cond_itr : target.lto) {
+            const TomlBasicValue *report;
+            if (cond_itr.first.empty()) {
+                report = &t.find("lto");
+            } else {
+                report = &t.find(cond_itr.first).as_table().find("lto").value();
+            }
+            if (parse_ltoMode(cond_itr.second) == lto_last) {
+                throw_key_error(unknown_lto_error(cond_itr.second), cond_itr.second, *report);
+            }
+            check_link_options_version(*this, "lto", *report);
+        }
+
+        t.optional("pgo", target.pgo);
+        for (const auto &cond_itr : target.pgo) {
+            if (cond_itr.first.empty()) {
+                check_link_options_version(*this, "pgo", t.find("pgo"));
+            } else {
+                check_link_options_version(*this, "pgo", t.find(cond_itr.first).as_table().find("pgo").value());
+            }
+        }
+
+        if (t.contains("bolt")) {
+            const auto &value = t.find("bolt");
+            auto &bolt = target.bolt;
+            bolt.specified = true;
+            bolt.enable = true;
+            if (value.is_boolean()) {
+                bolt.enable = value.as_boolean();
+            } else {
+                auto &b = checker.create(value);
+                b.optional("enable", bolt.enable);
+                b.optional("options", bolt.options);
+                b.optional("install", bolt.install);
+                if (b.contains("training")) {
+                    for (const auto &run : b.find("training").as_array()) {
+                        auto &r = checker.create(run);
+                        BoltTraining training;
+                        r.optional("arguments", training.arguments);
+                        r.optional("working-directory", training.working_directory);
+                        bolt.training.push_back(training);
+                    }
+                }
+            }
+            if (bolt.enable) {
+                check_link_options_version(*this, "bolt", value);
+            }
+        }
+
+        if (t.contains("unity")) {
+            const auto &value = t.find("unity");
+            auto &unity = target.unity;
+            unity.specified = true;
+            if (value.is_boolean()) {
+                unity.enable = value.as_boolean();
+            } else {
+                auto &u = checker.create(value);
+                u.optional("enable", unity.enable);
+                u.optional("batch-size", unity.batch_size);
+                if (unity.batch_size < 0 && u.contains("batch-size")) {
+                    throw_key_error("The unity batch-size cannot be negative", "batch-size", u.find("batch-size"));
+                }
+                std::string mode;
+                u.optional("mode", mode);
+                if (!mode.empty()) {
+                    unity.mode = parse_unityMode(mode);
+                    if (unity.mode == unity_last) {
+                        std::string error = "Unknown unity mode '" + mode + "'\n";
+                        error += "Available modes:\n";
+                        for (std::string mode_name : unityModeNames) {
+                            error += "  - " + mode_name + "\n";
+                        }
+                        error.pop_back(); // Remove last newline
+                        throw_key_error(error, mode, u.find("mode"));
+                    }
+                }
+                u.optional("exclude", unity.exclude);
+            }
+        }
+
         t.optional("condition", target.condition);
         t.optional("alias", target.alias);
 
@@ -783,10 +1144,8 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
                 }
             }
 
-            for (const auto &tmplate : templates) {
-                if (name == tmplate.outline.name) {
-                    throw_key_error("Template '" + name + "' already defined", name, itr.second);
-                }
+            if (find_template(name) != nullptr) {
+                throw_key_error("Template '" + name + "' already defined", name, itr.second);
             }
 
             Template tmplate;
@@ -803,26 +1162,32 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
 
     if (checker.contains("target")) {
         const auto &ts = toml::find(toml, "target").as_table();
+        // Target is not nothrow movable, growing the vector would copy every target
+        targets.reserve(ts.size());
         for (const auto &itr : ts) {
             auto &t = checker.create(itr.second);
             targets.push_back(parse_target(itr.first, t, false));
         }
     }
 
-    if (checker.contains("test")) {
-        const auto &ts = toml::find(toml, "test").as_array();
-        for (const auto &value : ts) {
-            auto &t = checker.create(value);
-            Test test;
-            t.required("name", test.name);
-            t.optional("condition", test.condition);
-            t.optional("configurations", test.configurations);
-            t.optional("working-directory", test.working_directory);
-            t.required("command", test.command);
-            t.optional("arguments", test.arguments);
-            tests.push_back(test);
+    auto parse_tests = [&](const toml::key &key, std::vector<Test> &destination) {
+        if (checker.contains(key)) {
+            const auto &ts = toml::find(toml, key).as_array();
+            for (const auto &value : ts) {
+                auto &t = checker.create(value);
+                Test test;
+                t.required("name", test.name);
+                t.optional("condition", test.condition);
+                t.optional("configurations", test.configurations);
+                t.optional("working-directory", test.working_directory);
+                t.required("command", test.command);
+                t.optional("arguments", test.arguments);
+                destination.push_back(test);
+            }
         }
-    }
+    };
+    parse_tests("test", tests);
+    parse_tests("pgo-training", pgo_trainings);
 
     if (checker.contains("install")) {
         const auto &is = toml::find(toml, "install").as_array();
@@ -888,7 +1253,7 @@ Project::Project(const Project *parent, const std::string &path, bool build) : p
         }
     }
 
-    checker.check(conditions, true);
+    checker.check(*this, true);
 }
 
 const Project *Project::root() const {
@@ -898,6 +1263,36 @@ const Project *Project::root() const {
     return root;
 }
 
+const std::string *Project::find_condition(const std::string &name) const {
+    for (const Project *scope = this; scope != nullptr; scope = scope->parent) {
+        auto itr = scope->conditions.find(name);
+        if (itr != scope->conditions.end()) {
+            return &itr->second;
+        }
+    }
+    return nullptr;
+}
+
+const Template *Project::find_template(const std::string &name) const {
+    for (const Project *scope = this; scope != nullptr; scope = scope->parent) {
+        for (const auto &tmplate : scope->templates) {
+            if (tmplate.outline.name == name) {
+                return &tmplate;
+            }
+        }
+    }
+    return nullptr;
+}
+
+LtoMode Project::find_lto() const {
+    for (const Project *scope = this; scope != nullptr; scope = scope->parent) {
+        if (scope->project_lto != lto_last) {
+            return scope->project_lto;
+        }
+    }
+    return lto_last;
+}
+
 bool Project::cmake_minimum_version(int major, int minor) const {
     // NOTE: this code is like pulling teeth, sorry
     auto root_version = root()->cmake_version;
@@ -928,11 +1323,16 @@ bool Project::is_condition_name(const std::string &name) {
 
 bool is_root_path(const std::string &path) {
     const auto toml_path = fs::path(path) / "cmake.toml";
-    if (!fs::exists(toml_path)) {
+    const auto document = load_document(toml_path);
+    if (!document) {
         return false;
     }
-    const auto toml = toml::parse<toml::discard_comments, tsl::ordered_map, std::vector>(toml_path.string());
-    return toml.contains("project");
+    return parse_document(*document, toml_path).contains("project");
+}
+
+std::string toml_hash(const std::string &path) {
+    const auto document = load_document(fs::path(path) / "cmake.toml");
+    return document ? document->hash : "-";
 }
 
 } // namespace parser
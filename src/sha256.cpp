@@ -0,0 +1,128 @@
+#include "sha256.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace cmkr {
+namespace sha256 {
+
+// Reference: FIPS 180-4
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa,
+    0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85,
+    0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f,
+    0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+Hasher::Hasher() {
+    static const uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(m_state, initial_state, sizeof(m_state));
+}
+
+void Hasher::transform(const unsigned char *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    auto e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for (int i = 0; i < 64; i++) {
+        auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        auto ch = (e & f) ^ (~e & g);
+        auto temp1 = h + s1 + ch + round_constants[i] + w[i];
+        auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        auto maj = (a & b) ^ (a & c) ^ (b & c);
+        auto temp2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void Hasher::update(const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    m_length += size;
+    while (size > 0) {
+        auto length = sizeof(m_block) - m_block_size;
+        if (length > size) {
+            length = size;
+        }
+        memcpy(m_block + m_block_size, bytes, length);
+        m_block_size += length;
+        bytes += length;
+        size -= length;
+        if (m_block_size == sizeof(m_block)) {
+            transform(m_block);
+            m_block_size = 0;
+        }
+    }
+}
+
+std::string Hasher::finish() {
+    auto bit_length = m_length * 8;
+    unsigned char padding[72] = {0x80};
+    auto padding_size = (m_block_size < 56 ? 56 : 120) - m_block_size;
+    for (int i = 0; i < 8; i++) {
+        padding[padding_size + i] = static_cast<unsigned char>(bit_length >> (56 - i * 8));
+    }
+    update(padding, padding_size + 8);
+
+    std::string digest;
+    digest.reserve(64);
+    for (auto word : m_state) {
+        char buffer[9];
+        (void)snprintf(buffer, sizeof(buffer), "%08x", static_cast<unsigned int>(word));
+        digest += buffer;
+    }
+    return digest;
+}
+
+std::string hash_string(const std::string &data) {
+    Hasher hasher;
+    hasher.update(data.data(), data.size());
+    return hasher.finish();
+}
+
+std::string hash_file(const fs::path &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return "-";
+    }
+    Hasher hasher;
+    char buffer[16 * 1024];
+    while (ifs) {
+        ifs.read(buffer, sizeof(buffer));
+        hasher.update(buffer, static_cast<size_t>(ifs.gcount()));
+    }
+    return hasher.finish();
+}
+
+} // namespace sha256
+} // namespace cmkr
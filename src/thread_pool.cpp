@@ -0,0 +1,110 @@
+#include "thread_pool.hpp"
+
+namespace cmkr {
+namespace pool {
+
+ThreadPool::ThreadPool(unsigned int jobs) {
+    if (jobs == 0) {
+        jobs = std::thread::hardware_concurrency();
+    }
+    m_jobs = jobs == 0 ? 1 : jobs;
+    for (unsigned int i = 1; i < m_jobs; i++) {
+        m_workers.emplace_back(&ThreadPool::worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::worker() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this]() {
+            return m_stop || !m_queue.empty();
+        });
+        if (m_queue.empty()) {
+            return;
+        }
+        auto task = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        execute(task);
+        lock.lock();
+    }
+}
+
+void ThreadPool::execute(Task &task) {
+    std::exception_ptr error;
+    try {
+        task.fn();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto group = task.group;
+        if (error && !group->m_error) {
+            group->m_error = error;
+        }
+        group->m_pending--;
+    }
+    // Wake up threads waiting on the group as well as idle workers
+    m_cv.notify_all();
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // Errors have to be handled by calling wait() explicitly
+    }
+}
+
+void TaskGroup::run(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(m_pool.m_mutex);
+        m_pending++;
+        m_pool.m_queue.push_back(ThreadPool::Task{this, std::move(fn)});
+    }
+    m_pool.m_cv.notify_one();
+}
+
+void TaskGroup::wait() {
+    std::unique_lock<std::mutex> lock(m_pool.m_mutex);
+    while (m_pending > 0) {
+        // Only tasks of this group, running unrelated tasks (that wait on their own
+        // groups) here would nest on the stack once for every queued task
+        auto &queue = m_pool.m_queue;
+        auto itr = queue.begin();
+        while (itr != queue.end() && itr->group != this) {
+            ++itr;
+        }
+        if (itr != queue.end()) {
+            auto task = std::move(*itr);
+            queue.erase(itr);
+            lock.unlock();
+            m_pool.execute(task);
+            lock.lock();
+        } else {
+            m_pool.m_cv.wait(lock);
+        }
+    }
+
+    if (m_error) {
+        auto error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace pool
+} // namespace cmkr
@@ -0,0 +1,28 @@
+#include "toml_parser.hpp"
+
+template cmkr::parser::TomlBasicValue toml::parse<toml::discard_comments, tsl::ordered_map, std::vector>(std::istream &, std::string);
+
+namespace cmkr {
+namespace parser {
+
+TomlBasicValue parse_toml(std::istream &is, const std::string &filename) {
+    return toml::parse<toml::discard_comments, tsl::ordered_map, std::vector>(is, filename);
+}
+
+bool toml_error_location(const std::exception &e, diag::Diagnostic &diagnostic) {
+    auto error = dynamic_cast<const toml::exception *>(&e);
+    if (error == nullptr) {
+        return false;
+    }
+    const auto &loc = error->location();
+    if (loc.line() == 0) {
+        return false;
+    }
+    diagnostic.file = loc.file_name();
+    diagnostic.line = loc.line();
+    diagnostic.column = loc.column();
+    return true;
+}
+
+} // namespace parser
+} // namespace cmkr
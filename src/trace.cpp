@@ -0,0 +1,253 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace cmkr {
+namespace trace {
+
+Recorder::Recorder() : m_start(std::chrono::steady_clock::now()) {
+    // The thread that creates the recorder is the main thread
+    m_threads.emplace(std::this_thread::get_id(), 0);
+}
+
+long long Recorder::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void Recorder::record(Event event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto itr = m_threads.find(std::this_thread::get_id());
+    if (itr == m_threads.end()) {
+        itr = m_threads.emplace(std::this_thread::get_id(), static_cast<unsigned int>(m_threads.size())).first;
+    }
+    event.thread = itr->second;
+    m_events.push_back(std::move(event));
+}
+
+static void write_json_string(std::ostream &os, const std::string &str) {
+    os << '"';
+    for (char ch : str) {
+        switch (ch) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        case '\t':
+            os << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(ch));
+                os << escaped;
+            } else {
+                os << ch;
+            }
+            break;
+        }
+    }
+    os << '"';
+}
+
+void Recorder::write_chrome(const fs::path &file) const {
+    std::ostringstream oss;
+    oss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto first = true;
+        for (const auto &itr : m_threads) {
+            oss << (first ? "\n" : ",\n");
+            first = false;
+            oss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << itr.second << ",\"args\":{\"name\":";
+            write_json_string(oss, itr.second == 0 ? "cmkr" : "cmkr worker " + std::to_string(itr.second));
+            oss << "}}";
+        }
+        for (const auto &event : m_events) {
+            oss << (first ? "\n" : ",\n");
+            first = false;
+            oss << "{\"name\":";
+            write_json_string(oss, event.name);
+            oss << ",\"cat\":";
+            write_json_string(oss, event.category);
+            oss << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << event.thread;
+            if (!event.directory.empty()) {
+                oss << ",\"args\":{\"directory\":";
+                write_json_string(oss, event.directory);
+                oss << '}';
+            }
+            oss << '}';
+        }
+    }
+    oss << "\n]}\n";
+
+    if (!file.parent_path().empty()) {
+        fs::create_directories(file.parent_path());
+    }
+    std::ofstream ofs(file, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error("Failed to create " + file.string());
+    }
+    ofs << oss.str();
+}
+
+static bool is_phase(const Event &event) {
+    std::string category = event.category;
+    return category != "directory" && category != "target";
+}
+
+std::vector<Recorder::Total> Recorder::totals() const {
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        events = m_events;
+    }
+
+    // Events on the same thread are properly nested, parents sort before their children
+    std::vector<size_t> order(events.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&events](size_t a, size_t b) {
+        const auto &x = events[a];
+        const auto &y = events[b];
+        if (x.thread != y.thread) {
+            return x.thread < y.thread;
+        }
+        if (x.start != y.start) {
+            return x.start < y.start;
+        }
+        return x.duration > y.duration;
+    });
+
+    const auto none = std::string::npos;
+    std::vector<size_t> parents(events.size(), none);
+    std::vector<long long> self(events.size());
+    std::vector<size_t> stack;
+    for (auto index : order) {
+        const auto &event = events[index];
+        while (!stack.empty()) {
+            const auto &top = events[stack.back()];
+            if (top.thread == event.thread && event.start + event.duration <= top.start + top.duration) {
+                break;
+            }
+            stack.pop_back();
+        }
+        if (!stack.empty()) {
+            parents[index] = stack.back();
+            self[stack.back()] -= event.duration;
+        }
+        self[index] += event.duration;
+        stack.push_back(index);
+    }
+
+    std::vector<Total> totals;
+    auto total = [&totals](const std::string &category) -> Total & {
+        auto itr = std::find_if(totals.begin(), totals.end(), [&category](const Total &total) {
+            return total.category == category;
+        });
+        if (itr == totals.end()) {
+            totals.emplace_back();
+            itr = totals.end() - 1;
+            itr->category = category;
+        }
+        return *itr;
+    };
+    for (size_t i = 0; i < events.size(); i++) {
+        if (is_phase(events[i])) {
+            auto &phase = total(events[i].category);
+            phase.duration += self[i];
+            phase.count++;
+            continue;
+        }
+        // The own time of a target belongs to the enclosing phase (emit), a directory has no phase
+        if (std::string(events[i].category) == "target") {
+            for (auto parent = parents[i]; parent != none; parent = parents[parent]) {
+                if (is_phase(events[parent])) {
+                    total(events[parent].category).duration += self[i];
+                    break;
+                }
+                if (std::string(events[parent].category) == "directory") {
+                    break;
+                }
+            }
+        }
+    }
+    return totals;
+}
+
+void Recorder::print_summary(size_t count) const {
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        events = m_events;
+    }
+
+    std::vector<const Event *> directories;
+    std::vector<const Event *> targets;
+    for (const auto &event : events) {
+        std::string category = event.category;
+        if (category == "directory") {
+            directories.push_back(&event);
+        } else if (category == "target") {
+            targets.push_back(&event);
+        }
+    }
+
+    auto milliseconds = [](long long duration) {
+        return static_cast<double>(duration) / 1000.0;
+    };
+
+    // Phases run concurrently in different directories, so the totals can exceed the wall time
+    printf("[trace] %-10s %10s %8s\n", "phase", "total ms", "count");
+    for (const auto &total : totals()) {
+        printf("[trace] %-10s %10.3f %8zu\n", total.category.c_str(), milliseconds(total.duration), total.count);
+    }
+
+    auto print_slowest = [&](const char *title, std::vector<const Event *> &slowest, bool with_directory) {
+        if (slowest.empty()) {
+            return;
+        }
+        std::stable_sort(slowest.begin(), slowest.end(), [](const Event *a, const Event *b) {
+            return a->duration > b->duration;
+        });
+        printf("[trace] slowest %s:\n", title);
+        for (size_t i = 0; i < slowest.size() && i < count; i++) {
+            const auto &event = *slowest[i];
+            if (with_directory) {
+                printf("[trace] %10.3f ms  %s (%s)\n", milliseconds(event.duration), event.name.c_str(), event.directory.c_str());
+            } else {
+                printf("[trace] %10.3f ms  %s\n", milliseconds(event.duration), event.name.c_str());
+            }
+        }
+    };
+    print_slowest("directories", directories, false);
+    print_slowest("targets", targets, true);
+}
+
+Scope::Scope(Recorder *recorder, const char *category, const std::string &name, const std::string &directory) : m_recorder(recorder) {
+    if (m_recorder != nullptr) {
+        m_event.name = name;
+        m_event.category = category;
+        m_event.directory = directory;
+        m_event.start = m_recorder->now();
+    }
+}
+
+Scope::~Scope() {
+    if (m_recorder != nullptr) {
+        m_event.duration = m_recorder->now() - m_event.start;
+        m_recorder->record(std::move(m_event));
+    }
+}
+
+} // namespace trace
+} // namespace cmkr
@@ -0,0 +1,327 @@
+#include "watch.hpp"
+
+#include "diagnostics.hpp"
+#include "fs.hpp"
+#include "manifest.hpp"
+#include "project_parser.hpp"
+#include "toml_parser.hpp"
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include <tsl/ordered_map.h>
+#include <tsl/ordered_set.h>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cmkr {
+namespace watch {
+
+#ifdef __linux__
+
+static std::string normalize(const fs::path &path) {
+    auto key = fs::absolute(path).lexically_normal().generic_string();
+    while (key.size() > 1 && key.back() == '/') {
+        key.pop_back();
+    }
+    return key;
+}
+
+// A directory that does not exist (yet) is watched through its nearest existing parent.
+// Directories that are watched already still exist, a removal is reported as an event.
+static std::string existing_directory(const fs::path &path, const tsl::ordered_map<std::string, int> &watched) {
+    fs::path directory = normalize(path);
+    if (watched.count(directory.generic_string()) != 0) {
+        return directory.generic_string();
+    }
+    std::error_code ec;
+    while (!fs::is_directory(directory, ec) && directory.has_relative_path()) {
+        directory = directory.parent_path();
+    }
+    return directory.generic_string();
+}
+
+// Every directory whose changes can affect the generated files: the directories with a
+// cmake.toml, the ones a glob or existence check listed and the parents of the other inputs
+// and the generated files. Subdirectories that were not generated are watched for a cmake.toml.
+static tsl::ordered_set<std::string> watched_directories(const fs::path &root, const gen::Session &session,
+                                                        const tsl::ordered_map<std::string, int> &watched) {
+    tsl::ordered_set<std::string> directories;
+    auto watch = [&](const fs::path &path) {
+        directories.insert(existing_directory(path, watched));
+    };
+    watch(root);
+    // Until a generation succeeds the manifest does not know these
+    for (const auto &path : session.visited) {
+        watch(path);
+    }
+    for (const auto &itr : session.manifest.directories()) {
+        auto path = root / itr.first;
+        const auto &directory = itr.second;
+        watch(path);
+        for (const auto &listing : directory.listings) {
+            watch(path / listing.first);
+        }
+        for (const auto &input : directory.inputs) {
+            watch((path / input.first).parent_path());
+        }
+        for (const auto &output : directory.outputs) {
+            watch((path / output.first).parent_path());
+        }
+        for (const auto &subdir : directory.subdirs) {
+            if (!subdir.generated) {
+                watch(root / subdir.key);
+            }
+        }
+    }
+    return directories;
+}
+
+static bool is_temporary(const std::string &name) {
+    // Written by files::write before it is renamed over the destination
+    return name.compare(0, 6, ".cmkr-") == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0;
+}
+
+class Inotify {
+    int m_fd = -1;
+    tsl::ordered_map<int, std::string> m_paths;
+    tsl::ordered_map<std::string, int> m_watches;
+
+  public:
+    Inotify() {
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0) {
+            throw std::runtime_error(std::string("Failed to initialize inotify: ") + strerror(errno));
+        }
+    }
+    Inotify(const Inotify &) = delete;
+    Inotify &operator=(const Inotify &) = delete;
+    ~Inotify() {
+        close(m_fd);
+    }
+
+    int fd() const {
+        return m_fd;
+    }
+
+    size_t size() const {
+        return m_watches.size();
+    }
+
+    const std::string *path(int wd) const {
+        auto itr = m_paths.find(wd);
+        return itr == m_paths.end() ? nullptr : &itr->second;
+    }
+
+    const tsl::ordered_map<std::string, int> &watches() const {
+        return m_watches;
+    }
+
+    void sync(const tsl::ordered_set<std::string> &directories) {
+        for (auto itr = m_watches.begin(); itr != m_watches.end();) {
+            if (directories.count(itr->first) == 0) {
+                inotify_rm_watch(m_fd, itr->second);
+                m_paths.erase(itr->second);
+                itr = m_watches.erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+
+        const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+        for (const auto &directory : directories) {
+            if (m_watches.count(directory) != 0) {
+                continue;
+            }
+            auto wd = inotify_add_watch(m_fd, directory.c_str(), mask);
+            if (wd < 0) {
+                if (errno == ENOSPC) {
+                    throw std::runtime_error("Too many directories to watch, raise fs.inotify.max_user_watches");
+                }
+                // Removed in the meantime, its parent reports when it comes back
+                continue;
+            }
+            m_paths[wd] = directory;
+            m_watches[directory] = wd;
+        }
+    }
+
+    // Forget a watch the kernel removed (the directory was deleted or unmounted)
+    void removed(int wd) {
+        auto itr = m_paths.find(wd);
+        if (itr != m_paths.end()) {
+            m_watches.erase(itr->second);
+            m_paths.erase(itr);
+        }
+    }
+};
+
+static bool stopped(const Options &options) {
+    return options.stop != nullptr && options.stop->load();
+}
+
+void run(const std::string &path, const Options &options) {
+    if (!options.generator.cache_dir.empty() || !options.generator.trace.empty()) {
+        throw std::runtime_error("cmkr watch does not support --cache-dir and --trace");
+    }
+
+    gen::Session session;
+    Inotify inotify;
+    fs::path root(path);
+    // Files written by the last generation, their own events are not changes
+    tsl::ordered_set<std::string> written;
+    std::string error_directory;
+
+    auto generate = [&](bool initial) {
+        Generation generation;
+        generation.initial = initial;
+        std::vector<gen::OutputFile> outputs;
+        auto generator = options.generator;
+        generator.write = true;
+        generator.session = &session;
+        generator.outputs = &outputs;
+
+        auto start = std::chrono::steady_clock::now();
+        // Watched until the error is fixed, the generation might not have reached the directory
+        diag::Diagnostic error;
+        try {
+            gen::generate_cmake(path.c_str(), generator);
+            generation.success = true;
+        } catch (const diag::Error &e) {
+            generation.error = e.what();
+            error = e.diagnostic();
+        } catch (const std::exception &e) {
+            generation.error = e.what();
+            parser::toml_error_location(e, error);
+        }
+        error_directory = error.file.empty() ? std::string() : fs::path(error.file).parent_path().string();
+        generation.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        written.clear();
+        for (const auto &output : outputs) {
+            if (output.changed) {
+                generation.written.push_back(output.path);
+                written.insert(normalize(output.path));
+                // The events of the written files are ignored, so the next validation
+                // has to know the new contents
+                session.directories.set_file_hash(output.path, manifest::hash_string(output.contents));
+            }
+        }
+
+        // A failed generation keeps the manifest of the previous one
+        auto directories = watched_directories(root, session, inotify.watches());
+        if (!error_directory.empty()) {
+            directories.insert(existing_directory(error_directory, inotify.watches()));
+        }
+        inotify.sync(directories);
+        generation.directories = inotify.size();
+        if (options.report) {
+            options.report(generation);
+        }
+    };
+
+    generate(true);
+
+    // Alignment required by struct inotify_event
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    tsl::ordered_set<std::string> changed;
+    bool overflow = false;
+    while (!stopped(options)) {
+        pollfd pfd{};
+        pfd.fd = inotify.fd();
+        pfd.events = POLLIN;
+        // Wait for the first event, then keep reading until the changes settle (editors
+        // and version control touch several files at once)
+        auto timeout = changed.empty() && !overflow ? 100 : 20;
+        auto ready = poll(&pfd, 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to wait for inotify events: ") + strerror(errno));
+        }
+
+        if (ready == 0) {
+            if (changed.empty() && !overflow) {
+                continue;
+            }
+            if (overflow) {
+                for (const auto &itr : inotify.watches()) {
+                    changed.insert(itr.first);
+                }
+            }
+            for (const auto &directory : changed) {
+                session.directories.invalidate(directory);
+                parser::forget_toml(directory);
+            }
+            changed.clear();
+            overflow = false;
+            generate(false);
+            continue;
+        }
+
+        auto length = read(inotify.fd(), buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to read inotify events: ") + strerror(errno));
+        }
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            auto directory = inotify.path(event->wd);
+            if (directory == nullptr) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                inotify.removed(event->wd);
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                // The listing of the parent changed as well
+                changed.insert(*directory);
+                changed.insert(fs::path(*directory).parent_path().generic_string());
+                continue;
+            }
+
+            std::string name = event->len > 0 ? event->name : "";
+            if (is_temporary(name)) {
+                continue;
+            }
+            auto file = *directory + "/" + name;
+            if ((event->mask & (IN_MOVED_TO | IN_CLOSE_WRITE)) && written.erase(file) != 0) {
+                continue;
+            }
+            changed.insert(*directory);
+            if (event->mask & IN_ISDIR) {
+                // The subdirectory itself was created, removed or renamed
+                changed.insert(file);
+            }
+        }
+    }
+}
+
+#else
+
+void run(const std::string &, const Options &) {
+    throw std::runtime_error("cmkr watch is only supported on Linux");
+}
+
+#endif
+
+} // namespace watch
+} // namespace cmkr
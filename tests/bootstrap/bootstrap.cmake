@@ -0,0 +1,117 @@
+# Compares a cold bootstrap of cmkr (building a source archive, without git) with the
+# prebuilt binary path of cmkr.cmake. Usage:
+#   cmake -DCMKR_SOURCE_DIR=<cmkr> -DWORK_DIR=<scratch> [-DCOLD_BUDGET=<seconds>] -P bootstrap.cmake
+# With COLD_BUDGET the cold bootstrap (configure and build of cmkr) fails if it takes longer.
+cmake_minimum_required(VERSION 3.15)
+
+if(NOT CMKR_SOURCE_DIR OR NOT WORK_DIR)
+    message(FATAL_ERROR "CMKR_SOURCE_DIR and WORK_DIR are required")
+endif()
+
+function(run)
+    execute_process(COMMAND ${ARGV} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "run(${ARGV}) failed (exit code ${result})")
+    endif()
+endfunction()
+
+function(milliseconds result)
+    if(CMAKE_VERSION VERSION_LESS 3.23)
+        string(TIMESTAMP now "%s")
+        math(EXPR now "${now} * 1000")
+    else()
+        string(TIMESTAMP now "%s%f")
+        math(EXPR now "${now} / 1000")
+    endif()
+    set("${result}" "${now}" PARENT_SCOPE)
+endfunction()
+
+function(write_sha256 file)
+    file(SHA256 "${file}" hash)
+    get_filename_component(name "${file}" NAME)
+    file(WRITE "${file}.sha256" "${hash}  ${name}\n")
+endfunction()
+
+# Same key as cmkr.cmake
+file(STRINGS "${CMKR_SOURCE_DIR}/cmake/cmkr.cmake" tag_line REGEX "^set\\(CMKR_TAG ")
+string(REGEX REPLACE "^set\\(CMKR_TAG \"([^\"]+)\".*" "\\1" tag "${tag_line}")
+cmake_host_system_information(RESULT platform QUERY OS_PLATFORM)
+string(TOLOWER "${platform}-${CMAKE_HOST_SYSTEM_NAME}" host)
+if(WIN32)
+    set(executable_name "cmkr.exe")
+else()
+    set(executable_name "cmkr")
+endif()
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# The project to configure, using the cmkr.cmake from this tree
+file(COPY "${CMAKE_CURRENT_LIST_DIR}/cmake.toml" "${CMAKE_CURRENT_LIST_DIR}/src" DESTINATION "${WORK_DIR}/project")
+file(COPY "${CMKR_SOURCE_DIR}/cmake/cmkr.cmake" DESTINATION "${WORK_DIR}/project")
+file(WRITE "${WORK_DIR}/project/CMakeLists.txt" "cmake_minimum_required(VERSION 3.15)\ninclude(cmkr.cmake)\ncmkr()\nmessage(FATAL_ERROR \"cmkr() did not generate the project\")\n")
+
+# Source archive of this tree
+set(source_archive "${WORK_DIR}/cmkr-source.tar.gz")
+set(source_files CMakeLists.txt cmake.toml cmake include src third_party tests/cmake.toml tests/library)
+if(EXISTS "${CMKR_SOURCE_DIR}/tests/CMakeLists.txt")
+    list(APPEND source_files tests/CMakeLists.txt)
+endif()
+execute_process(COMMAND "${CMAKE_COMMAND}" -E tar czf "${source_archive}" ${source_files}
+    WORKING_DIRECTORY "${CMKR_SOURCE_DIR}"
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to create ${source_archive}")
+endif()
+write_sha256("${source_archive}")
+
+# Configures the project in a fresh build directory, the environment must not skip generation
+function(configure name result)
+    milliseconds(start)
+    run("${CMAKE_COMMAND}" -E env --unset=CI --unset=CMKR_CACHE --unset=CMKR_PREBUILT_DIR --unset=CMKR_SOURCE_ARCHIVE
+        "${CMAKE_COMMAND}" -S "${WORK_DIR}/project" -B "${WORK_DIR}/${name}" ${ARGN}
+    )
+    milliseconds(stop)
+    math(EXPR elapsed "${stop} - ${start}")
+    if(NOT EXISTS "${WORK_DIR}/${name}/_cmkr_${tag}/bin/${executable_name}")
+        message(FATAL_ERROR "[bootstrap] ${name}: cmkr was not bootstrapped")
+    endif()
+    set("${result}" "${elapsed}" PARENT_SCOPE)
+endfunction()
+
+configure(cold cold_ms "-DCMKR_SOURCE_ARCHIVE=${source_archive}")
+
+# Prebuilt directory, keyed by tag and host
+set(prebuilt_dir "${WORK_DIR}/prebuilt")
+file(COPY "${WORK_DIR}/cold/_cmkr_${tag}/bin/${executable_name}" DESTINATION "${prebuilt_dir}/${tag}/${host}")
+write_sha256("${prebuilt_dir}/${tag}/${host}/${executable_name}")
+configure(prebuilt prebuilt_ms "-DCMKR_PREBUILT_DIR=${prebuilt_dir}")
+
+# Prebuilt archive
+file(REMOVE_RECURSE "${prebuilt_dir}")
+file(MAKE_DIRECTORY "${prebuilt_dir}")
+set(prebuilt_archive "${prebuilt_dir}/cmkr-${tag}-${host}.tar.gz")
+run("${CMAKE_COMMAND}" -E chdir "${WORK_DIR}/cold/_cmkr_${tag}" "${CMAKE_COMMAND}" -E tar czf "${prebuilt_archive}" "bin/${executable_name}")
+write_sha256("${prebuilt_archive}")
+configure(archive archive_ms "-DCMKR_PREBUILT_DIR=${prebuilt_dir}")
+
+foreach(name prebuilt archive)
+    if(EXISTS "${WORK_DIR}/${name}/_cmkr_${tag}/build")
+        message(FATAL_ERROR "[bootstrap] ${name}: cmkr was built from source")
+    endif()
+endforeach()
+
+message(STATUS "[bootstrap] cold (source archive): ${cold_ms} ms")
+message(STATUS "[bootstrap] prebuilt binary: ${prebuilt_ms} ms")
+message(STATUS "[bootstrap] prebuilt archive: ${archive_ms} ms")
+if(NOT prebuilt_ms LESS cold_ms OR NOT archive_ms LESS cold_ms)
+    message(FATAL_ERROR "[bootstrap] The prebuilt path is not faster than a cold bootstrap")
+endif()
+if(COLD_BUDGET)
+    math(EXPR budget_ms "${COLD_BUDGET} * 1000")
+    if(cold_ms GREATER budget_ms)
+        message(FATAL_ERROR "[bootstrap] The cold bootstrap took ${cold_ms} ms, the budget is ${COLD_BUDGET} s")
+    endif()
+    message(STATUS "[bootstrap] cold bootstrap within the ${COLD_BUDGET} s budget")
+endif()
@@ -0,0 +1,5 @@
+#include <cstdio>
+
+int main() {
+    puts("Hello from a bootstrapped cmkr!");
+}
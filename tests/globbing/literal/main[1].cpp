@@ -0,0 +1,5 @@
+int generated();
+
+int main() {
+    return generated();
+}
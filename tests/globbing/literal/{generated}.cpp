@@ -0,0 +1,3 @@
+int generated() {
+    return 0;
+}
@@ -0,0 +1 @@
+#error This file is excluded by a negative pattern
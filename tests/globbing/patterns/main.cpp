@@ -0,0 +1,5 @@
+#include "modules/modules.hpp"
+
+int main() {
+    return module_a() + module_b() == 3 ? 0 : 1;
+}
@@ -0,0 +1,5 @@
+#include "modules.hpp"
+
+int module_a() {
+    return 1;
+}
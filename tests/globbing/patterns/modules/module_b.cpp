@@ -0,0 +1,5 @@
+#include "modules.hpp"
+
+int module_b() {
+    return 2;
+}
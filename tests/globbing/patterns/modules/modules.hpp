@@ -0,0 +1,4 @@
+#pragma once
+
+int module_a();
+int module_b();
@@ -0,0 +1,166 @@
+# Checks that an incremental generation (cmkr gen --cache-dir) writes the same files as a
+# full generation after every kind of change the generation manifest tracks. Usage:
+#   cmake -DCMKR=<cmkr executable> -DWORK_DIR=<scratch> -P incremental.cmake
+cmake_minimum_required(VERSION 3.15)
+
+if(NOT CMKR OR NOT WORK_DIR)
+    message(FATAL_ERROR "CMKR and WORK_DIR are required")
+endif()
+
+set(project "${WORK_DIR}/project")
+set(fresh "${WORK_DIR}/fresh")
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(WRITE "${project}/cmake.toml" [[
+[project]
+name = "incremental"
+glob-ignore-files = [".cmkrignore"]
+
+[conditions]
+custom = "CMKR_CUSTOM"
+
+[template.component]
+type = "static"
+
+[subdir.a]
+[subdir.b]
+
+# The existence of explicit sources is only checked for the types with a language
+[target.root]
+type = "static"
+sources = ["src/link.cpp"]
+]])
+file(WRITE "${project}/.cmkrignore" "*_generated.cpp\n")
+file(WRITE "${project}/a/cmake.toml" [[
+[target.a]
+type = "component"
+sources = ["src/*.cpp", "!src/skip.cpp"]
+custom.compile-definitions = ["CUSTOM"]
+]])
+foreach(source a1 a2 skip x_generated)
+    file(WRITE "${project}/a/src/${source}.cpp" "void ${source}() {}\n")
+endforeach()
+file(WRITE "${project}/b/cmake.toml" [[
+[subdir.c]
+
+[target.b]
+type = "component"
+sources = ["src/**.cpp"]
+]])
+file(WRITE "${project}/b/src/b1.cpp" "void b1() {}\n")
+file(WRITE "${project}/b/src/nested/b2.cpp" "void b2() {}\n")
+file(WRITE "${project}/b/c/cmake.toml" [[
+[target.c]
+type = "component"
+sources = ["src/c.cpp"]
+]])
+file(WRITE "${project}/b/c/src/c.cpp" "void c() {}\n")
+
+# A source that is a symbolic link to a file in another directory
+function(link_source)
+    if(WIN32)
+        # Creating symbolic links requires extra privileges
+        configure_file("${project}/other/real.cpp" "${project}/src/link.cpp" COPYONLY)
+    else()
+        file(MAKE_DIRECTORY "${project}/src")
+        file(CREATE_LINK "../other/real.cpp" "${project}/src/link.cpp" SYMBOLIC)
+    endif()
+endfunction()
+file(WRITE "${project}/other/real.cpp" "void root() {}\n")
+link_source()
+
+# Directories modified within two seconds are not persisted in the cache
+function(settle)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E sleep 2.2)
+endfunction()
+
+function(generated_files directory result)
+    file(GLOB_RECURSE files RELATIVE "${directory}" "${directory}/CMakeLists.txt")
+    list(SORT files)
+    set("${result}" "${files}" PARENT_SCOPE)
+endfunction()
+
+# Generates a copy of the project from scratch and the project itself with its cache,
+# with FAILURE both generations have to fail
+function(check step)
+    file(REMOVE_RECURSE "${fresh}")
+    file(COPY "${project}/" DESTINATION "${fresh}")
+    file(REMOVE_RECURSE "${fresh}/cache")
+    generated_files("${fresh}" stale)
+    foreach(file IN LISTS stale)
+        file(REMOVE "${fresh}/${file}")
+    endforeach()
+
+    execute_process(COMMAND "${CMKR}" gen WORKING_DIRECTORY "${fresh}" RESULT_VARIABLE fresh_result OUTPUT_QUIET ERROR_QUIET)
+    execute_process(COMMAND "${CMKR}" gen --cache-dir cache
+        WORKING_DIRECTORY "${project}"
+        RESULT_VARIABLE incremental_result
+        OUTPUT_VARIABLE incremental_output
+        ERROR_VARIABLE incremental_output
+    )
+    if(ARGN STREQUAL "FAILURE")
+        if(fresh_result EQUAL 0 OR incremental_result EQUAL 0)
+            message(FATAL_ERROR "[incremental] ${step}: the full generation exited with ${fresh_result}, "
+                "the incremental generation with ${incremental_result}, both should fail")
+        endif()
+        message(STATUS "[incremental] ${step}: both generations failed")
+        return()
+    endif()
+    if(NOT fresh_result EQUAL 0 OR NOT incremental_result EQUAL 0)
+        message(FATAL_ERROR "[incremental] ${step}: the full generation exited with ${fresh_result}, "
+            "the incremental generation with ${incremental_result}:\n${incremental_output}")
+    endif()
+
+    generated_files("${fresh}" fresh_files)
+    generated_files("${project}" incremental_files)
+    if(NOT fresh_files STREQUAL incremental_files)
+        message(FATAL_ERROR "[incremental] ${step}: generated ${incremental_files}, expected ${fresh_files}")
+    endif()
+    foreach(file IN LISTS fresh_files)
+        file(SHA256 "${fresh}/${file}" expected)
+        file(SHA256 "${project}/${file}" actual)
+        if(NOT expected STREQUAL actual)
+            message(FATAL_ERROR "[incremental] ${step}: ${file} differs from a full generation")
+        endif()
+    endforeach()
+    message(STATUS "[incremental] ${step}: identical")
+endfunction()
+
+check("initial generation")
+settle()
+check("persisted snapshots")
+
+file(APPEND "${project}/a/src/a1.cpp" "void a1_edited() {}\n")
+check("edited source")
+
+file(WRITE "${project}/a/src/a3.cpp" "void a3() {}\n")
+check("added source")
+
+file(REMOVE "${project}/b/src/nested/b2.cpp")
+check("removed source")
+
+file(WRITE "${project}/b/src/deep/d.cpp" "void d() {}\n")
+check("added directory")
+
+file(READ "${project}/cmake.toml" toml)
+string(REPLACE "CMKR_CUSTOM" "CMKR_OTHER" toml "${toml}")
+file(WRITE "${project}/cmake.toml" "${toml}")
+check("parent condition")
+
+file(APPEND "${project}/.cmkrignore" "a2.cpp\n")
+check("ignore file")
+
+settle()
+check("persisted snapshots after the changes")
+
+file(REMOVE "${project}/other/real.cpp")
+if(WIN32)
+    file(REMOVE "${project}/src/link.cpp")
+endif()
+check("removed link target" FAILURE)
+
+file(WRITE "${project}/other/real.cpp" "void root() {}\n")
+if(WIN32)
+    link_source()
+endif()
+check("restored link target")
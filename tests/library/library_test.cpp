@@ -0,0 +1,118 @@
+// Checks the results of the cmkr_lib API that tools depend on. Usage:
+//   cmkr_library_test <scratch directory>
+#include "library.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using namespace cmkr;
+
+void check(bool condition, const std::string &message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+void write_file(const fs::path &path, const std::string &contents) {
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error("Failed to create " + path.string());
+    }
+    ofs << contents;
+}
+
+std::string project_toml(const std::string &name) {
+    return "[project]\nname = \"" + name + "\"\n\n[target." + name + "]\ntype = \"executable\"\nsources = [\"src/main.cpp\"]\n";
+}
+
+const gen::OutputFile *find_file(const lib::Result &result, const fs::path &path) {
+    for (const auto &file : result.files) {
+        if (file.path == path.string()) {
+            return &file;
+        }
+    }
+    return nullptr;
+}
+
+void in_memory(const fs::path &directory) {
+    auto result = lib::generate_toml(directory.string(), project_toml("hello"));
+    check(result.success && result.diagnostics.empty(), "in-memory generation failed");
+    check(result.cmakelists.find("add_executable(hello)") != std::string::npos, "add_executable(hello) was not generated");
+    auto cmakelists = find_file(result, directory / "CMakeLists.txt");
+    check(cmakelists != nullptr && cmakelists->changed, "CMakeLists.txt was not reported");
+    check(find_file(result, directory / "cmkr.cmake") != nullptr, "cmkr.cmake was not reported");
+    check(!fs::exists(directory / "CMakeLists.txt") && !fs::exists(directory / "cmkr.cmake"), "the in-memory generation wrote files");
+
+    // Also without options.write when the cmake.toml is read from disk
+    write_file(directory / "cmake.toml", project_toml("hello"));
+    result = lib::generate(directory.string());
+    check(result.success && !fs::exists(directory / "CMakeLists.txt"), "the generation wrote files without options.write");
+}
+
+void written(const fs::path &directory) {
+    lib::Options options;
+    options.write = true;
+    write_file(directory / "cmake.toml", project_toml("hello"));
+    auto result = lib::generate(directory.string(), options);
+    check(result.success && fs::exists(directory / "CMakeLists.txt"), "CMakeLists.txt was not written");
+    result = lib::generate(directory.string(), options);
+    auto cmakelists = find_file(result, directory / "CMakeLists.txt");
+    check(result.success && cmakelists != nullptr && !cmakelists->changed, "an unchanged CMakeLists.txt was reported as changed");
+}
+
+void diagnostics(const fs::path &directory) {
+    // [settings] has been renamed to [variables], the warning points at line 11
+    auto result = lib::generate_toml(directory.string(), project_toml("hello") + "\n[variables]\nA = \"1\"\n\n[settings]\nB = \"2\"\n");
+    check(result.success && result.diagnostics.size() == 1, "expected a single warning");
+    const auto &warning = result.diagnostics[0];
+    check(warning.severity == diag::severity_warning && warning.message == "[settings] has been renamed to [variables]",
+          "unexpected warning '" + warning.message + "'");
+    check(warning.file == (directory / "cmake.toml").string() && warning.line == 11, "unexpected warning location");
+
+    result = lib::generate_toml(directory.string(),
+                                project_toml("hello") + "\n[target.missing]\ntype = \"executable\"\nsources = [\"src/missing.cpp\"]\n");
+    check(!result.success && result.files.empty(), "a missing source did not fail the generation");
+    check(result.diagnostics.size() == 1 && result.diagnostics[0].severity == diag::severity_error, "expected a single error");
+
+    result = lib::generate_toml(directory.string(), "[project]\nname = \"hello\n");
+    check(!result.success && result.diagnostics.size() == 1 && result.diagnostics[0].line == 2, "expected a syntax error on line 2");
+}
+
+} // namespace
+
+int main(int argc, char **argv) try {
+    if (argc != 2) {
+        throw std::runtime_error("Usage: cmkr_library_test <scratch directory>");
+    }
+    fs::path root(argv[1]);
+    fs::remove_all(root);
+
+    const struct {
+        const char *name;
+        void (*run)(const fs::path &);
+    } checks[] = {
+        {"in-memory", in_memory},
+        {"written", written},
+        {"diagnostics", diagnostics},
+    };
+    for (const auto &itr : checks) {
+        auto directory = root / itr.name;
+        write_file(directory / "src/main.cpp", "int main() {}\n");
+        try {
+            itr.run(directory);
+        } catch (const std::exception &e) {
+            throw std::runtime_error(std::string(itr.name) + ": " + e.what());
+        }
+        printf("[library] %s: passed\n", itr.name);
+    }
+    return EXIT_SUCCESS;
+} catch (const std::exception &e) {
+    (void)fprintf(stderr, "[cmkr_library_test] error: %s\n", e.what());
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+# Builds the lto example with Clang and checks that the lto = "full" target is compiled and
+# linked with -flto=full, and the lto = "thin" target with -flto=thin. Skipped when Clang
+# is not found. Usage:
+#   cmake -DCMKR=<cmkr executable> -DWORK_DIR=<scratch> -P lto-clang.cmake
+cmake_minimum_required(VERSION 3.15)
+
+if(NOT CMKR OR NOT WORK_DIR)
+    message(FATAL_ERROR "CMKR and WORK_DIR are required")
+endif()
+
+find_program(CLANGXX NAMES clang++ clang++-19 clang++-18 clang++-17 clang++-16 clang++-15 clang++-14)
+if(NOT CLANGXX)
+    message(STATUS "[lto-clang] skipped, clang++ was not found")
+    return()
+endif()
+
+set(project "${WORK_DIR}/project")
+set(build "${WORK_DIR}/build")
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(COPY "${CMAKE_CURRENT_LIST_DIR}/../lto/cmake.toml" "${CMAKE_CURRENT_LIST_DIR}/../lto/src" DESTINATION "${project}")
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "[lto-clang] ${ARGN} failed (exit code ${result})")
+    endif()
+endfunction()
+
+run("${CMKR}" gen WORKING_DIRECTORY "${project}")
+run("${CMAKE_COMMAND}" -S "${project}" -B "${build}"
+    -DCMKR_SKIP_GENERATION=ON
+    -DCMAKE_BUILD_TYPE=Release
+    -DCMAKE_EXPORT_COMPILE_COMMANDS=ON
+    "-DCMAKE_CXX_COMPILER=${CLANGXX}"
+)
+run("${CMAKE_COMMAND}" --build "${build}")
+file(STRINGS "${build}/CMakeCache.txt" supported REGEX "^CMKR_LTO_SUPPORTED:")
+string(REGEX REPLACE "^[^=]*=" "" supported "${supported}")
+if(NOT supported)
+    message(STATUS "[lto-clang] skipped, link-time optimization is not supported")
+    return()
+endif()
+
+# The last -flto option decides the mode, the other mode must not appear at all
+function(check_mode target mode other)
+    file(READ "${build}/compile_commands.json" commands)
+    string(REGEX MATCHALL "\"command\": \"[^\"]*CMakeFiles/${target}\\.dir/[^\"]*\"" compiles "${commands}")
+    file(READ "${build}/CMakeFiles/${target}.dir/link.txt" link)
+    if(NOT compiles)
+        message(FATAL_ERROR "[lto-clang] no compile commands for ${target}")
+    endif()
+    foreach(command IN LISTS compiles ITEMS "${link}")
+        if(NOT command MATCHES "-flto=${mode}" OR command MATCHES "-flto=${other}")
+            message(FATAL_ERROR "[lto-clang] ${target} is not built with -flto=${mode}:\n${command}")
+        endif()
+    endforeach()
+endfunction()
+check_mode(lto thin full)
+check_mode(lto-full full thin)
+message(STATUS "[lto-clang] passed")
@@ -0,0 +1,8 @@
+#include <cstdio>
+
+int square(int x);
+
+int main() {
+    // With link-time optimization the call can be inlined
+    printf("Hello from cmkr: %d\n", square(7));
+}
@@ -0,0 +1,74 @@
+# Checks that the link-time, profile-guided and BOLT optimizations are set up for every
+# target when the first target that enables them has a false condition. Usage:
+#   cmake -DCMKR=<cmkr executable> -DWORK_DIR=<scratch> -P optimization-conditions.cmake
+cmake_minimum_required(VERSION 3.15)
+
+if(NOT CMKR OR NOT WORK_DIR)
+    message(FATAL_ERROR "CMKR and WORK_DIR are required")
+endif()
+
+set(project "${WORK_DIR}/project")
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(WRITE "${project}/cmake.toml" [==[
+[cmake]
+version = "3.15"
+
+[project]
+name = "optimization-conditions"
+
+[conditions]
+never = "CMKR_NEVER"
+
+[template.optimized]
+type = "executable"
+lto = "thin"
+pgo = true
+bolt = true
+
+[target.first]
+type = "optimized"
+condition = "never"
+sources = ["src/main.cpp"]
+
+[target.second]
+type = "optimized"
+sources = ["src/main.cpp"]
+cmake-after = """
+if(NOT DEFINED CMKR_LTO_SUPPORTED)
+    message(FATAL_ERROR "CMKR_LTO_SUPPORTED is not defined")
+endif()
+get_target_property(ipo second INTERPROCEDURAL_OPTIMIZATION)
+if(CMKR_LTO_SUPPORTED AND NOT ipo)
+    message(FATAL_ERROR "second is not built with link-time optimization")
+endif()
+if(NOT CMKR_PGO_FLAGS)
+    message(FATAL_ERROR "CMKR_PGO_FLAGS is not set for the generate phase")
+endif()
+if(NOT DEFINED CMKR_BOLT)
+    message(FATAL_ERROR "CMKR_BOLT is not defined")
+endif()
+if(CMKR_BOLT AND NOT TARGET second-bolt)
+    message(FATAL_ERROR "second is not optimized with BOLT")
+endif()
+"""
+]==])
+file(WRITE "${project}/src/main.cpp" "int main() {}\n")
+
+execute_process(COMMAND "${CMKR}" gen WORKING_DIRECTORY "${project}" RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "[optimization-conditions] cmkr gen failed")
+endif()
+
+# Only the configure step is checked, the stand-ins for llvm-bolt and merge-fdata are never run
+execute_process(COMMAND "${CMAKE_COMMAND}" -S "${project}" -B "${WORK_DIR}/build"
+    -DCMKR_SKIP_GENERATION=ON
+    -DCMAKE_BUILD_TYPE=Release
+    -DCMKR_PGO=generate
+    "-DCMKR_LLVM_BOLT=${CMAKE_COMMAND}"
+    "-DCMKR_MERGE_FDATA=${CMAKE_COMMAND}"
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "[optimization-conditions] configuring the project failed")
+endif()
+message(STATUS "[optimization-conditions] passed")
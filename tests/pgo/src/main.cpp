@@ -0,0 +1,24 @@
+#include <cstdio>
+#include <cstdlib>
+
+// The branches are weighted by the profile of the training run
+static int collatz(long long n) {
+    int steps = 0;
+    while (n != 1) {
+        n = n % 2 == 0 ? n / 2 : 3 * n + 1;
+        steps++;
+    }
+    return steps;
+}
+
+int main(int argc, char **argv) {
+    long long count = argc > 1 ? atoll(argv[1]) : 1000;
+    int longest = 0;
+    for (long long i = 1; i <= count; i++) {
+        int steps = collatz(i);
+        if (steps > longest) {
+            longest = steps;
+        }
+    }
+    printf("Hello from cmkr: %d steps\n", longest);
+}
@@ -0,0 +1,88 @@
+# Checks the stamp that lets the cmkr() macro in cmkr.cmake skip cmkr gen on a configure
+# where nothing changed, and that cmkr gen --cache-dir is only used when the executable
+# supports it. Usage:
+#   cmake -DCMKR=<cmkr executable> -DCMKR_SOURCE_DIR=<cmkr source> -DWORK_DIR=<scratch> -P stamp.cmake
+cmake_minimum_required(VERSION 3.15)
+
+if(NOT CMKR OR NOT CMKR_SOURCE_DIR OR NOT WORK_DIR)
+    message(FATAL_ERROR "CMKR, CMKR_SOURCE_DIR and WORK_DIR are required")
+endif()
+
+set(project "${WORK_DIR}/project")
+set(build "${WORK_DIR}/build")
+set(stamp "${build}/cmkr-cache/cmkr-stamp.cmake")
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(WRITE "${project}/cmake.toml" [[
+[project]
+name = "stamp"
+
+[target.stamp]
+type = "executable"
+sources = ["src/*.cpp"]
+]])
+file(WRITE "${project}/src/main.cpp" "int main() {}\n")
+file(COPY "${CMKR_SOURCE_DIR}/cmake/cmkr.cmake" DESTINATION "${project}")
+file(WRITE "${project}/CMakeLists.txt" "cmake_minimum_required(VERSION 3.15)\ninclude(cmkr.cmake)\ncmkr()\n")
+
+# Configures the project and returns the verbose output
+function(configure executable result)
+    execute_process(COMMAND "${CMAKE_COMMAND}" -E env --unset=CI
+        "${CMAKE_COMMAND}" -S "${project}" -B "${build}" --log-level=VERBOSE "-DCMKR_EXECUTABLE=${executable}"
+        RESULT_VARIABLE exit_code
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output
+    )
+    if(NOT exit_code EQUAL 0)
+        message(FATAL_ERROR "[stamp] configuring failed:\n${output}")
+    endif()
+    set("${result}" "${output}" PARENT_SCOPE)
+endfunction()
+
+function(expect step output pattern)
+    if(NOT output MATCHES "${pattern}")
+        message(FATAL_ERROR "[stamp] ${step}: expected '${pattern}' in:\n${output}")
+    endif()
+    message(STATUS "[stamp] ${step}: passed")
+endfunction()
+
+# The directories were just created, so their timestamps cannot be trusted yet
+configure("${CMKR}" output)
+file(READ "${stamp}" contents)
+expect("racy directories are stored" "${contents}" "\"racy\"")
+configure("${CMKR}" output)
+expect("racy directories generate again" "${output}" "was modified during the last generation")
+
+execute_process(COMMAND "${CMAKE_COMMAND}" -E sleep 2.2)
+configure("${CMKR}" output)
+file(READ "${stamp}" contents)
+if(contents MATCHES "\"racy\"")
+    message(FATAL_ERROR "[stamp] the settled directories are still racy:\n${contents}")
+endif()
+configure("${CMKR}" output)
+expect("unchanged project" "${output}" "Skipping generation")
+
+file(WRITE "${project}/src/other.cpp" "void other() {}\n")
+configure("${CMKR}" output)
+file(READ "${project}/CMakeLists.txt" contents)
+expect("added source" "${contents}" "src/other.cpp")
+
+# A cmkr without --cache-dir in its help, like the releases before it was added
+if(NOT WIN32)
+    set(old "${WORK_DIR}/old/cmkr")
+    file(WRITE "${old}" "#!/bin/sh
+echo \"$*\" >> \"${WORK_DIR}/old/arguments.txt\"
+case \"$1\" in
+    version) echo '[cmkr] cmkr version 0.0.1' >&2 ;;
+    help) echo 'gen    Generates CMakeLists.txt file.' >&2 ;;
+    gen) ;;
+    *) exit 1 ;;
+esac
+")
+    file(CHMOD "${old}" PERMISSIONS OWNER_READ OWNER_WRITE OWNER_EXECUTE)
+    configure("${old}" output)
+    file(READ "${WORK_DIR}/old/arguments.txt" arguments)
+    if(NOT arguments MATCHES "(^|\n)gen\n" OR arguments MATCHES "--cache-dir")
+        message(FATAL_ERROR "[stamp] unexpected arguments for an older cmkr:\n${arguments}")
+    endif()
+    message(STATUS "[stamp] older cmkr: passed")
+endif()
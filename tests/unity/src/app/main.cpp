@@ -0,0 +1,8 @@
+#include <cstdio>
+
+int core_value();
+int standalone_value();
+
+int main() {
+    printf("Hello from a unity build: %d\n", core_value() + standalone_value());
+}
@@ -0,0 +1,8 @@
+// Defines the same static function as core.cpp, so it cannot be part of the unity source
+static int value() {
+    return 2;
+}
+
+int standalone_value() {
+    return value();
+}